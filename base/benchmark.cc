@@ -0,0 +1,77 @@
+
+#include "benchmark.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+namespace benchmark {
+namespace {
+static BenchmarkEnvironment* benchmark_environment_instance = nullptr;
+
+typedef std::chrono::steady_clock Clock;
+
+// Formats `value` per second with a metric prefix, e.g. "1.53 G".
+std::string HumanRate(double value) {
+  const char* prefixes[] = {"", "k", "M", "G", "T"};
+  int i = 0;
+  while (value >= 1000.0 && i < 4) {
+    value /= 1000.0;
+    ++i;
+  }
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.2f %s", value, prefixes[i]);
+  return buffer;
+}
+}  // namespace
+
+Benchmark::Benchmark(const std::string& name) : name_(name) {
+  BenchmarkEnvironment::GetInstance()->RegisterBenchmark(this);
+}
+
+// static
+BenchmarkEnvironment* BenchmarkEnvironment::GetInstance() {
+  if (benchmark_environment_instance == nullptr) {
+    benchmark_environment_instance = new BenchmarkEnvironment();
+  }
+  return benchmark_environment_instance;
+}
+
+void BenchmarkEnvironment::RunAll() {
+  fprintf(stderr, "Running %zu benchmarks...\n\n", benchmarks_.size());
+  fprintf(stderr, "%-40s %12s %10s %16s\n", "Benchmark", "ns/pass", "passes", "throughput");
+  for (Benchmark* benchmark : benchmarks_) {
+    // Warm up caches and lazily built state.
+    benchmark->Run();
+
+    size_t passes = 0;
+    const Clock::time_point start = Clock::now();
+    double elapsed = 0.0;
+    while (elapsed < min_seconds_) {
+      benchmark->Run();
+      ++passes;
+      elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    const double seconds_per_pass = elapsed / passes;
+    std::string throughput;
+    if (benchmark->items_processed() > 0) {
+      throughput = HumanRate(benchmark->items_processed() / seconds_per_pass) +
+                   benchmark->unit() + "/s";
+    }
+    fprintf(stderr, "%-40s %12.0f %10zu %16s\n", benchmark->name().c_str(),
+            seconds_per_pass * 1e9, passes, throughput.c_str());
+  }
+  fprintf(stderr, "\n");
+}
+
+}  // namespace benchmark
+
+// BenchmarkMain
+// Optional argument: minimum number of seconds per benchmark.
+int main(int argc, char** argv) {
+  if (argc > 1) {
+    benchmark::BenchmarkEnvironment::GetInstance()->SetMinSeconds(atof(argv[1]));
+  }
+  benchmark::BenchmarkEnvironment::GetInstance()->RunAll();
+}
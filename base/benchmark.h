@@ -0,0 +1,93 @@
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+// Micro benchmarks
+//
+// Each benchmark body is one pass over its workload. The runner repeats the
+// pass until enough time has elapsed and reports the time per pass together
+// with the throughput of whatever the body reported as processed.
+//
+// Example:
+//
+// BENCHMARK(push_bytes) {
+//   for (int i = 0; i < 1000; ++i) bit_stream.PushByte(i);
+//   SetItemsProcessed(8 * 1000, "bits");
+// }
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#define BENCHMARK_INTERNAL(classname) \
+class classname##Benchmark : public benchmark::Benchmark { \
+ public: \
+  classname##Benchmark() : benchmark::Benchmark(#classname) {} \
+  void Run() override; \
+}; \
+static classname##Benchmark classname##_benchmark_instance_; \
+void classname##Benchmark::Run()
+
+#define BENCHMARK(classname) BENCHMARK_INTERNAL(classname)
+
+namespace benchmark {
+
+// Prevents the compiler from optimizing away a computed value.
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+class Benchmark {
+ public:
+  explicit Benchmark(const std::string& name);
+  virtual ~Benchmark() {}
+
+  // Runs one pass of the workload.
+  virtual void Run() = 0;
+
+  const std::string& name() const { return name_; }
+  double items_processed() const { return items_processed_; }
+  const std::string& unit() const { return unit_; }
+
+ protected:
+  // Amount of work done by one pass, used for the throughput column.
+  void SetItemsProcessed(double items, const std::string& unit) {
+    items_processed_ = items;
+    unit_ = unit;
+  }
+  void SetBytesProcessed(double bytes) { SetItemsProcessed(bytes, "B"); }
+
+ private:
+  const std::string name_;
+  double items_processed_ = 0;
+  std::string unit_;
+};
+
+// Singleton that gathers the benchmarks and runs them in registration order.
+class BenchmarkEnvironment {
+ public:
+  // Not threadsafe!
+  static BenchmarkEnvironment* GetInstance();
+
+  void RegisterBenchmark(Benchmark* benchmark) {
+    if (benchmark != nullptr) {
+      benchmarks_.push_back(benchmark);
+    }
+  }
+
+  // Minimum wall time spent repeating each benchmark.
+  void SetMinSeconds(double seconds) { min_seconds_ = seconds; }
+
+  void RunAll();
+
+ private:
+  BenchmarkEnvironment() {}
+
+  std::vector<Benchmark*> benchmarks_;
+  double min_seconds_ = 0.5;
+};
+
+}  // namespace benchmark
+
+#endif
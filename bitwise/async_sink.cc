@@ -0,0 +1,76 @@
+#include "async_sink.h"
+
+#include <algorithm>
+
+namespace bitstream {
+
+AsyncSink::AsyncSink(ByteSink* target, size_t buffer_size, size_t num_buffers)
+    : target_(target), ring_(std::max<size_t>(num_buffers, 1)), failed_(!target->ok()) {
+  for (Buffer& buffer : ring_) {
+    buffer.data.resize(std::max<size_t>(buffer_size, 8));
+  }
+  writer_ = std::thread(&AsyncSink::WriterLoop, this);
+}
+
+AsyncSink::~AsyncSink() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  changed_.notify_all();
+  // The writer drains all pending buffers before exiting.
+  writer_.join();
+  target_->Flush();
+}
+
+uint8_t* AsyncSink::Reserve(size_t /*size_hint*/, size_t* size) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [this] { return pending_ < ring_.size(); });
+  Buffer& buffer = ring_[next_fill_];
+  *size = buffer.data.size();
+  return buffer.data.data();
+}
+
+void AsyncSink::Commit(size_t size) {
+  if (size == 0) return;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ring_[next_fill_].size = size;
+    next_fill_ = (next_fill_ + 1) % ring_.size();
+    ++pending_;
+  }
+  changed_.notify_all();
+}
+
+void AsyncSink::Flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [this] { return pending_ == 0; });
+  // The writer is idle until the next Commit, which this thread would do.
+  target_->Flush();
+}
+
+bool AsyncSink::ok() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return !failed_;
+}
+
+void AsyncSink::WriterLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    changed_.wait(lock, [this] { return pending_ > 0 || stop_; });
+    if (pending_ == 0) return;  // Stopped and drained.
+
+    const Buffer& buffer = ring_[next_write_];
+    // The producer does not touch committed buffers, so no lock is needed while writing.
+    lock.unlock();
+    const bool written = target_->Write(buffer.data.data(), buffer.size) && target_->ok();
+    lock.lock();
+
+    failed_ |= !written;
+    next_write_ = (next_write_ + 1) % ring_.size();
+    --pending_;
+    changed_.notify_all();
+  }
+}
+
+}  // namespace bitstream
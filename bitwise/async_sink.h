@@ -0,0 +1,69 @@
+// Sink that writes to another sink on a background thread.
+//
+// Committed buffers are handed to a writer thread through a small ring of
+// fixed buffers, so the producer keeps filling the next buffer while the
+// previous one is being written. The producer only blocks when all buffers
+// are waiting to be written.
+//
+// Example:
+// bitstream::OstreamSink file_sink(&file);
+// bitstream::AsyncSink sink(&file_sink, 1 << 16, 4);
+// bitstream::BitOutStreamer bit_stream(&sink);
+
+#ifndef ASYNC_SINK_H_
+#define ASYNC_SINK_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "byte_sink.h"
+
+namespace bitstream {
+
+class AsyncSink : public ByteSink {
+ public:
+  // `target` must outlive this sink and is only written from the writer thread,
+  // except for Flush which waits until the writer is idle.
+  // Needs at least two buffers to overlap writing with producing.
+  AsyncSink(ByteSink* target, size_t buffer_size, size_t num_buffers);
+  // Writes all committed buffers and joins the writer thread.
+  ~AsyncSink();
+
+  AsyncSink(const AsyncSink&) = delete;
+
+  // Blocks until the next buffer in the ring is free.
+  uint8_t* Reserve(size_t size_hint, size_t* size) override;
+  // Hands the buffer to the writer thread.
+  void Commit(size_t size) override;
+  // Blocks until all committed buffers are written, then flushes the target.
+  void Flush() override;
+  bool ok() const override;
+
+ private:
+  struct Buffer {
+    std::vector<uint8_t> data;
+    size_t size = 0;
+  };
+
+  void WriterLoop();
+
+  ByteSink* target_;  // Not owned.
+  std::vector<Buffer> ring_;
+
+  // Guards everything below.
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+  size_t next_fill_ = 0;  // Next buffer for the producer.
+  size_t next_write_ = 0;  // Next buffer for the writer.
+  size_t pending_ = 0;  // Buffers committed but not yet written.
+  bool stop_ = false;
+  bool failed_;
+
+  std::thread writer_;
+};
+
+}  // namespace bitstream
+
+#endif
@@ -0,0 +1,107 @@
+#include "async_sink.h"
+
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "bitstream.h"
+#include "../base/testing.h"
+
+namespace bitstream {
+namespace {
+
+// Vector sink that takes its time, so the producer gets ahead of it.
+class SlowSink : public ByteSink {
+ public:
+  explicit SlowSink(std::vector<uint8_t>* out) : sink_(out) {}
+
+  uint8_t* Reserve(size_t size_hint, size_t* size) override {
+    return sink_.Reserve(size_hint, size);
+  }
+  void Commit(size_t size) override {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    sink_.Commit(size);
+    ++num_commits_;
+  }
+  void Flush() override { sink_.Flush(); }
+
+  int num_commits() const { return num_commits_; }
+
+ private:
+  VectorSink sink_;
+  int num_commits_ = 0;
+};
+
+std::string Pattern(size_t size) {
+  std::string result;
+  for (size_t i = 0; i < size; ++i) {
+    result.push_back('a' + (i * 7) % 26);
+  }
+  return result;
+}
+}  // namespace
+
+TEST(async_streamer) {
+  const std::string input = Pattern(100000);
+  std::ostringstream output;
+  {
+    BitOutStreamer bit_stream(&output);
+    bit_stream.SetBufferSize(1000);
+    bit_stream.SetAsync(3);
+    for (char c : input) {
+      bit_stream.PushByte(c);
+    }
+    bit_stream.FlushRemaining();
+    ASSERT_EQ(input, output.str());
+    ASSERT_TRUE(bit_stream.ok());
+
+    // Keeps working after a flush, and flushes again on destruction.
+    bit_stream.PushBits(0x61, 8);
+  }
+  ASSERT_EQ(input + "a", output.str());
+}
+
+TEST(async_slow_sink) {
+  const std::string input = Pattern(20000);
+  std::vector<uint8_t> bytes;
+  SlowSink slow_sink(&bytes);
+  {
+    AsyncSink sink(&slow_sink, 512, 4);
+    BitOutStreamer bit_stream(&sink);
+    bit_stream.SetBufferSize(500);
+    bit_stream.PushBit(true);
+    bit_stream.PushBytesAligned(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+    bit_stream.PushBits(0x7F, 7);
+    // Destructors flush the streamer and join the writer thread.
+  }
+  ASSERT_GE(slow_sink.num_commits(), 40);
+  ASSERT_EQ(input.size() + 1, bytes.size());
+
+  BitInStreamer in(bytes.data(), bytes.size());
+  ASSERT_TRUE(in.ReadBit());
+  std::string result;
+  for (size_t i = 0; i < input.size(); ++i) {
+    result.push_back(in.ReadBits(8));
+  }
+  ASSERT_EQ(input, result);
+  ASSERT_EQ(0x7F, in.ReadBits(7));
+  ASSERT_TRUE(in.AtEnd());
+}
+
+TEST(async_full_target) {
+  uint8_t memory[100];
+  SpanSink span_sink(memory, sizeof(memory));
+  AsyncSink sink(&span_sink, 64, 2);
+  BitOutStreamer bit_stream(&sink);
+  const std::string input = Pattern(1000);
+  for (char c : input) {
+    bit_stream.PushByte(c);
+  }
+  bit_stream.FlushRemaining();
+  ASSERT_FALSE(bit_stream.ok());
+  ASSERT_EQ(100, span_sink.size());
+  ASSERT_EQ(input.substr(0, 100), std::string(memory, memory + 100));
+}
+
+}  // namespace bitstream
@@ -0,0 +1,289 @@
+#include "big_int.h"
+
+#include <algorithm>
+
+namespace bitwise {
+namespace {
+typedef unsigned __int128 uint128;
+typedef std::vector<uint64_t> Limbs;
+
+void Trim(Limbs* a) {
+  while (!a->empty() && a->back() == 0) {
+    a->pop_back();
+  }
+}
+
+size_t TrimmedSize(const uint64_t* a, size_t n) {
+  while (n > 0 && a[n - 1] == 0) {
+    --n;
+  }
+  return n;
+}
+
+int CompareMagnitude(const Limbs& a, const Limbs& b) {
+  if (a.size() != b.size()) return a.size() < b.size() ? -1 : 1;
+  for (size_t i = a.size(); i-- > 0;) {
+    if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+  }
+  return 0;
+}
+
+// out[0, n) += b[0, nb). The sum must fit in n limbs.
+void AddTo(uint64_t* out, size_t n, const uint64_t* b, size_t nb) {
+  uint64_t carry = 0;
+  size_t i = 0;
+  for (; i < nb; ++i) {
+    const uint128 sum = uint128(out[i]) + b[i] + carry;
+    out[i] = uint64_t(sum);
+    carry = uint64_t(sum >> 64);
+  }
+  for (; carry != 0 && i < n; ++i) {
+    carry = ++out[i] == 0;
+  }
+}
+
+// a[0, n) -= b[0, nb). Requires a >= b.
+void SubFrom(uint64_t* a, size_t n, const uint64_t* b, size_t nb) {
+  uint64_t borrow = 0;
+  size_t i = 0;
+  for (; i < nb; ++i) {
+    const uint128 difference = uint128(a[i]) - b[i] - borrow;
+    a[i] = uint64_t(difference);
+    borrow = uint64_t(difference >> 64) & 1;
+  }
+  for (; borrow != 0 && i < n; ++i) {
+    borrow = a[i]-- == 0;
+  }
+}
+
+// out[0, na + nb) = a * b, where out starts zeroed.
+void MultiplySchoolbook(const uint64_t* a, size_t na, const uint64_t* b, size_t nb,
+                        uint64_t* out) {
+  for (size_t i = 0; i < na; ++i) {
+    const uint64_t digit = a[i];
+    uint64_t carry = 0;
+    for (size_t j = 0; j < nb; ++j) {
+      const uint128 product = uint128(digit) * b[j] + out[i + j] + carry;
+      out[i + j] = uint64_t(product);
+      carry = uint64_t(product >> 64);
+    }
+    out[i + nb] = carry;
+  }
+}
+
+// out[0, max(na, nb) + 1) = a + b.
+void Sum(const uint64_t* a, size_t na, const uint64_t* b, size_t nb, uint64_t* out) {
+  std::copy(a, a + na, out);
+  std::fill(out + na, out + std::max(na, nb) + 1, 0);
+  AddTo(out, std::max(na, nb) + 1, b, nb);
+}
+
+// out[0, na + nb) = a * b, where out starts zeroed.
+void Multiply(const uint64_t* a, size_t na, const uint64_t* b, size_t nb, uint64_t* out) {
+  if (na < nb) {
+    std::swap(a, b);
+    std::swap(na, nb);
+  }
+  if (nb < BigInt::kKaratsubaThreshold) {
+    MultiplySchoolbook(a, na, b, nb, out);
+    return;
+  }
+
+  if (na >= 2 * nb) {
+    // Unbalanced: slices of a as long as b.
+    Limbs product(2 * nb);
+    for (size_t i = 0; i < na; i += nb) {
+      const size_t n = std::min(nb, na - i);
+      std::fill(product.begin(), product.end(), 0);
+      Multiply(a + i, n, b, nb, product.data());
+      AddTo(out + i, na + nb - i, product.data(), n + nb);
+    }
+    return;
+  }
+
+  // a = a1 * B^m + a0 and b = b1 * B^m + b0, where B = 2^64. Then
+  // a * b = z2 * B^2m + z1 * B^m + z0, with z0 = a0 * b0, z2 = a1 * b1 and
+  // z1 = (a0 + a1) * (b0 + b1) - z0 - z2.
+  // Since nb > na / 2 >= m, both have a high part.
+  const size_t m = na / 2;
+  Multiply(a, m, b, m, out);
+  Multiply(a + m, na - m, b + m, nb - m, out + 2 * m);
+
+  Limbs sum_a(std::max(m, na - m) + 1);
+  Limbs sum_b(std::max(m, nb - m) + 1);
+  Sum(a, m, a + m, na - m, sum_a.data());
+  Sum(b, m, b + m, nb - m, sum_b.data());
+  const size_t n_sum_a = TrimmedSize(sum_a.data(), sum_a.size());
+  const size_t n_sum_b = TrimmedSize(sum_b.data(), sum_b.size());
+  Limbs z1(n_sum_a + n_sum_b);
+  Multiply(sum_a.data(), n_sum_a, sum_b.data(), n_sum_b, z1.data());
+  // Slices from the unbalanced case can have zero high limbs, so z0 and z2
+  // may be written over more limbs than z1 has. Their values fit in z1.
+  SubFrom(z1.data(), z1.size(), out, TrimmedSize(out, 2 * m));
+  SubFrom(z1.data(), z1.size(), out + 2 * m, TrimmedSize(out + 2 * m, na + nb - 2 * m));
+  AddTo(out + m, na + nb - m, z1.data(), TrimmedSize(z1.data(), z1.size()));
+}
+
+int HexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+}  // namespace
+
+BigInt::BigInt(int64_t value) : negative_(value < 0) {
+  // Negating the most negative value only works unsigned.
+  const uint64_t magnitude = value < 0 ? 0 - uint64_t(value) : uint64_t(value);
+  if (magnitude != 0) limbs_.push_back(magnitude);
+}
+
+BigInt BigInt::FromLimbs(std::vector<uint64_t> limbs, bool negative) {
+  BigInt result;
+  result.limbs_ = std::move(limbs);
+  Trim(&result.limbs_);
+  result.negative_ = negative && !result.limbs_.empty();
+  return result;
+}
+
+bool BigInt::FromHex(const std::string& hex, BigInt* result) {
+  const bool negative = !hex.empty() && hex[0] == '-';
+  const size_t begin = negative ? 1 : 0;
+  if (begin == hex.size()) return false;
+
+  Limbs limbs((hex.size() - begin + 15) / 16);
+  for (size_t i = 0; i < hex.size() - begin; ++i) {
+    const int digit = HexDigit(hex[hex.size() - 1 - i]);
+    if (digit < 0) return false;
+    limbs[i / 16] |= uint64_t(digit) << (4 * (i % 16));
+  }
+  *result = FromLimbs(std::move(limbs), negative);
+  return true;
+}
+
+std::string BigInt::ToHex() const {
+  if (is_zero()) return "0";
+  const char* kDigits = "0123456789abcdef";
+  std::string result = negative_ ? "-" : "";
+  bool leading = true;
+  for (size_t i = limbs_.size(); i-- > 0;) {
+    for (int shift = 60; shift >= 0; shift -= 4) {
+      const int digit = (limbs_[i] >> shift) & 0xF;
+      if (leading && digit == 0) continue;
+      leading = false;
+      result.push_back(kDigits[digit]);
+    }
+  }
+  return result;
+}
+
+size_t BigInt::BitLength() const {
+  if (is_zero()) return 0;
+  return 64 * limbs_.size() - __builtin_clzll(limbs_.back());
+}
+
+BigInt BigInt::operator-() const {
+  BigInt result = *this;
+  result.negative_ = !negative_ && !is_zero();
+  return result;
+}
+
+void BigInt::Add(const std::vector<uint64_t>& limbs, bool negative) {
+  if (&limbs == &limbs_) {
+    const Limbs copy = limbs;
+    Add(copy, negative);
+    return;
+  }
+  if (negative_ == negative) {
+    limbs_.resize(std::max(limbs_.size(), limbs.size()) + 1);
+    AddTo(limbs_.data(), limbs_.size(), limbs.data(), limbs.size());
+  } else if (CompareMagnitude(limbs_, limbs) >= 0) {
+    SubFrom(limbs_.data(), limbs_.size(), limbs.data(), limbs.size());
+  } else {
+    Limbs result = limbs;
+    SubFrom(result.data(), result.size(), limbs_.data(), limbs_.size());
+    limbs_ = std::move(result);
+    negative_ = negative;
+  }
+  Trim(&limbs_);
+  if (limbs_.empty()) negative_ = false;
+}
+
+BigInt& BigInt::operator+=(const BigInt& other) {
+  Add(other.limbs_, other.negative_);
+  return *this;
+}
+
+BigInt& BigInt::operator-=(const BigInt& other) {
+  Add(other.limbs_, !other.negative_ && !other.is_zero());
+  return *this;
+}
+
+BigInt& BigInt::operator<<=(size_t bits) {
+  if (is_zero()) return *this;
+  const size_t limb_shift = bits / 64;
+  const int bit_shift = bits % 64;
+  limbs_.resize(limbs_.size() + limb_shift + 1);
+  for (size_t i = limbs_.size() - 1; i > limb_shift; --i) {
+    const uint64_t high = limbs_[i - limb_shift];
+    const uint64_t low = limbs_[i - limb_shift - 1];
+    limbs_[i] = bit_shift == 0 ? high : (high << bit_shift) | (low >> (64 - bit_shift));
+  }
+  limbs_[limb_shift] = limbs_[0] << bit_shift;
+  std::fill(limbs_.begin(), limbs_.begin() + limb_shift, 0);
+  Trim(&limbs_);
+  return *this;
+}
+
+BigInt& BigInt::operator>>=(size_t bits) {
+  const size_t limb_shift = bits / 64;
+  const int bit_shift = bits % 64;
+  if (limb_shift >= limbs_.size()) {
+    *this = BigInt();
+    return *this;
+  }
+  const size_t n = limbs_.size() - limb_shift;
+  for (size_t i = 0; i < n; ++i) {
+    const uint64_t low = limbs_[i + limb_shift];
+    const uint64_t high = i + 1 < n ? limbs_[i + limb_shift + 1] : 0;
+    limbs_[i] = bit_shift == 0 ? low : (low >> bit_shift) | (high << (64 - bit_shift));
+  }
+  limbs_.resize(n);
+  Trim(&limbs_);
+  if (limbs_.empty()) negative_ = false;
+  return *this;
+}
+
+BigInt operator*(const BigInt& a, const BigInt& b) {
+  BigInt result;
+  if (a.is_zero() || b.is_zero()) return result;
+  result.limbs_.resize(a.limbs_.size() + b.limbs_.size());
+  Multiply(a.limbs_.data(), a.limbs_.size(), b.limbs_.data(), b.limbs_.size(),
+           result.limbs_.data());
+  Trim(&result.limbs_);
+  result.negative_ = a.negative_ != b.negative_;
+  return result;
+}
+
+BigInt BigInt::MultiplySchoolbook(const BigInt& a, const BigInt& b) {
+  BigInt result;
+  if (a.is_zero() || b.is_zero()) return result;
+  result.limbs_.resize(a.limbs_.size() + b.limbs_.size());
+  bitwise::MultiplySchoolbook(a.limbs_.data(), a.limbs_.size(), b.limbs_.data(),
+                              b.limbs_.size(), result.limbs_.data());
+  Trim(&result.limbs_);
+  result.negative_ = a.negative_ != b.negative_;
+  return result;
+}
+
+int BigInt::Compare(const BigInt& a, const BigInt& b) {
+  if (a.negative_ != b.negative_) return a.negative_ ? -1 : 1;
+  const int magnitude = CompareMagnitude(a.limbs_, b.limbs_);
+  return a.negative_ ? -magnitude : magnitude;
+}
+
+std::ostream& operator<<(std::ostream& out, const BigInt& value) {
+  return out << value.ToHex();
+}
+
+}  // namespace bitwise
@@ -0,0 +1,88 @@
+// Arbitrary-precision signed integer.
+//
+// The magnitude is stored as 64-bit limbs, least significant first, with no
+// leading zero limbs, and the sign separately. Unlike bitwise::Mult nothing
+// overflows: every result is exact.
+//
+// Multiplication runs a schoolbook loop on unsigned __int128 products for
+// small operands and Karatsuba above kKaratsubaThreshold limbs, which makes
+// it O(n^1.58) for large ones.
+//
+// Example:
+// BigInt a(1);
+// a <<= 1000;
+// BigInt b = a * a - BigInt(7);
+// std::cout << b;  // In hex.
+
+#ifndef BIG_INT_H_
+#define BIG_INT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace bitwise {
+
+class BigInt {
+ public:
+  // Operands of at least this many limbs are multiplied with Karatsuba.
+  static const size_t kKaratsubaThreshold = 32;
+
+  BigInt() = default;
+  explicit BigInt(int64_t value);
+  // Magnitude from limbs, least significant first.
+  static BigInt FromLimbs(std::vector<uint64_t> limbs, bool negative = false);
+
+  // Parses an optional '-' followed by hex digits.
+  // Returns false for anything else.
+  static bool FromHex(const std::string& hex, BigInt* result);
+  std::string ToHex() const;
+
+  const std::vector<uint64_t>& limbs() const { return limbs_; }
+  bool negative() const { return negative_; }
+  bool is_zero() const { return limbs_.empty(); }
+  // Number of bits in the magnitude.
+  size_t BitLength() const;
+
+  BigInt operator-() const;
+  BigInt& operator+=(const BigInt& other);
+  BigInt& operator-=(const BigInt& other);
+  BigInt& operator*=(const BigInt& other) { return *this = *this * other; }
+  // Shift the magnitude and keep the sign, so >> rounds towards zero.
+  BigInt& operator<<=(size_t bits);
+  BigInt& operator>>=(size_t bits);
+
+  friend BigInt operator+(BigInt a, const BigInt& b) { return a += b; }
+  friend BigInt operator-(BigInt a, const BigInt& b) { return a -= b; }
+  friend BigInt operator*(const BigInt& a, const BigInt& b);
+  friend BigInt operator<<(BigInt a, size_t bits) { return a <<= bits; }
+  friend BigInt operator>>(BigInt a, size_t bits) { return a >>= bits; }
+
+  // Multiplies with the schoolbook loop regardless of size.
+  // Mostly for checking and benchmarking against operator*.
+  static BigInt MultiplySchoolbook(const BigInt& a, const BigInt& b);
+
+  // Negative, zero or positive as a is less than, equal to or greater than b.
+  static int Compare(const BigInt& a, const BigInt& b);
+
+  friend bool operator==(const BigInt& a, const BigInt& b) {
+    return a.negative_ == b.negative_ && a.limbs_ == b.limbs_;
+  }
+  friend bool operator!=(const BigInt& a, const BigInt& b) { return !(a == b); }
+  friend bool operator<(const BigInt& a, const BigInt& b) { return Compare(a, b) < 0; }
+
+ private:
+  // Adds the value with magnitude `limbs` and sign `negative`.
+  void Add(const std::vector<uint64_t>& limbs, bool negative);
+
+  std::vector<uint64_t> limbs_;
+  bool negative_ = false;  // Never set for zero.
+};
+
+std::ostream& operator<<(std::ostream& out, const BigInt& value);
+
+}  // namespace bitwise
+
+#endif
@@ -0,0 +1,88 @@
+#include "big_int.h"
+
+#include <vector>
+
+#include "../base/benchmark.h"
+
+namespace bitwise {
+namespace {
+// Operand of `bits` bits with the top bit set.
+BigInt Operand(size_t bits, uint64_t seed) {
+  std::vector<uint64_t> limbs((bits + 63) / 64);
+  for (uint64_t& limb : limbs) {
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    limb = seed;
+  }
+  limbs.back() |= uint64_t(1) << 63;
+  return BigInt::FromLimbs(limbs);
+}
+
+template <size_t kBits>
+const BigInt& A() {
+  static const BigInt value = Operand(kBits, 1);
+  return value;
+}
+
+template <size_t kBits>
+const BigInt& B() {
+  static const BigInt value = Operand(kBits, 2);
+  return value;
+}
+}  // namespace
+
+BENCHMARK(mul_1k) {
+  benchmark::DoNotOptimize(A<1024>() * B<1024>());
+  SetItemsProcessed(1, "mul");
+}
+
+BENCHMARK(mul_schoolbook_1k) {
+  benchmark::DoNotOptimize(BigInt::MultiplySchoolbook(A<1024>(), B<1024>()));
+  SetItemsProcessed(1, "mul");
+}
+
+BENCHMARK(mul_4k) {
+  benchmark::DoNotOptimize(A<4096>() * B<4096>());
+  SetItemsProcessed(1, "mul");
+}
+
+BENCHMARK(mul_schoolbook_4k) {
+  benchmark::DoNotOptimize(BigInt::MultiplySchoolbook(A<4096>(), B<4096>()));
+  SetItemsProcessed(1, "mul");
+}
+
+BENCHMARK(mul_10k) {
+  benchmark::DoNotOptimize(A<10000>() * B<10000>());
+  SetItemsProcessed(1, "mul");
+}
+
+BENCHMARK(mul_schoolbook_10k) {
+  benchmark::DoNotOptimize(BigInt::MultiplySchoolbook(A<10000>(), B<10000>()));
+  SetItemsProcessed(1, "mul");
+}
+
+BENCHMARK(mul_100k) {
+  benchmark::DoNotOptimize(A<100000>() * B<100000>());
+  SetItemsProcessed(1, "mul");
+}
+
+BENCHMARK(mul_schoolbook_100k) {
+  benchmark::DoNotOptimize(BigInt::MultiplySchoolbook(A<100000>(), B<100000>()));
+  SetItemsProcessed(1, "mul");
+}
+
+BENCHMARK(mul_unbalanced_1k_100k) {
+  benchmark::DoNotOptimize(A<1024>() * B<100000>());
+  SetItemsProcessed(1, "mul");
+}
+
+BENCHMARK(add_100k) {
+  benchmark::DoNotOptimize(A<100000>() + B<100000>());
+  SetBytesProcessed(100000 / 8);
+}
+
+BENCHMARK(shift_100k) {
+  benchmark::DoNotOptimize(A<100000>() << 1001);
+  SetBytesProcessed(100000 / 8);
+}
+
+}  // namespace bitwise
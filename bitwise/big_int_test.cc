@@ -0,0 +1,126 @@
+#include "big_int.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "../base/testing.h"
+
+namespace bitwise {
+namespace {
+BigInt Random(size_t num_limbs, std::mt19937_64* rng) {
+  std::vector<uint64_t> limbs(num_limbs);
+  for (uint64_t& limb : limbs) {
+    limb = (*rng)();
+  }
+  return BigInt::FromLimbs(limbs);
+}
+
+BigInt Hex(const std::string& hex) {
+  BigInt result;
+  if (!BigInt::FromHex(hex, &result)) LOG(ERROR) << "Invalid hex " << hex;
+  return result;
+}
+}  // namespace
+
+TEST(big_int_small) {
+  std::mt19937_64 rng(1);
+  for (int i = 0; i < 1000; ++i) {
+    const int64_t a = int64_t(rng() % 2000000) - 1000000;
+    const int64_t b = int64_t(rng() % 2000000) - 1000000;
+    ASSERT_EQ(BigInt(a + b), BigInt(a) + BigInt(b));
+    ASSERT_EQ(BigInt(a - b), BigInt(a) - BigInt(b));
+    ASSERT_EQ(BigInt(a * b), BigInt(a) * BigInt(b));
+    ASSERT_TRUE((a < b) == (BigInt(a) < BigInt(b)));
+  }
+  ASSERT_TRUE(BigInt(0).is_zero());
+  ASSERT_FALSE((BigInt(5) - BigInt(5)).negative());
+  ASSERT_EQ("-8000000000000000", BigInt(INT64_MIN).ToHex());
+}
+
+TEST(big_int_hex) {
+  ASSERT_EQ("0", BigInt().ToHex());
+  ASSERT_EQ("-ff", BigInt(-255).ToHex());
+  const std::string hex = "123456789abcdef0fedcba9876543210f";
+  ASSERT_EQ(hex, Hex(hex).ToHex());
+  ASSERT_EQ(3, Hex(hex).limbs().size());
+  ASSERT_EQ(129, Hex(hex).BitLength());
+  BigInt value;
+  ASSERT_FALSE(BigInt::FromHex("", &value));
+  ASSERT_FALSE(BigInt::FromHex("-", &value));
+  ASSERT_FALSE(BigInt::FromHex("12g", &value));
+}
+
+TEST(big_int_carries) {
+  // (2^k - 1)^2 = 2^2k - 2^(k + 1) + 1
+  for (size_t k : {64, 100, 4096, 10000}) {
+    const BigInt ones = (BigInt(1) << k) - BigInt(1);
+    const BigInt expected = (BigInt(1) << (2 * k)) - (BigInt(1) << (k + 1)) + BigInt(1);
+    ASSERT_EQ(expected, ones * ones);
+    ASSERT_EQ(k, ones.BitLength());
+  }
+  ASSERT_EQ(Hex("10000000000000000"), Hex("ffffffffffffffff") + BigInt(1));
+  ASSERT_EQ(Hex("ffffffffffffffff"), Hex("10000000000000000") - BigInt(1));
+}
+
+TEST(big_int_shift) {
+  const BigInt value = Hex("-123456789abcdef0123");
+  for (size_t bits : {0, 1, 63, 64, 65, 200}) {
+    ASSERT_EQ(value, ((value << bits) >> bits));
+  }
+  ASSERT_EQ(Hex("-123"), (value >> 64));
+  ASSERT_TRUE((value >> 100).is_zero());
+  ASSERT_FALSE((value >> 100).negative());
+}
+
+TEST(big_int_karatsuba) {
+  std::mt19937_64 rng(2);
+  // Balanced, odd sized and unbalanced operands around the threshold.
+  const std::vector<std::pair<size_t, size_t>> sizes = {
+      {32, 32}, {33, 40}, {100, 100}, {255, 129}, {40, 500}, {1000, 1000}};
+  for (const auto& size : sizes) {
+    const BigInt a = Random(size.first, &rng);
+    const BigInt b = -Random(size.second, &rng);
+    const BigInt product = a * b;
+    ASSERT_EQ(BigInt::MultiplySchoolbook(a, b), product);
+    ASSERT_TRUE(product.negative());
+    ASSERT_EQ(a * a, BigInt::MultiplySchoolbook(a, a));
+  }
+}
+
+TEST(big_int_karatsuba_zero_runs) {
+  // Slices of the long operand end in zero limbs, and the short one has a
+  // zero run too, so the halves Karatsuba splits into trim unevenly.
+  std::vector<uint64_t> a(200, 0);
+  a[0] = 1;
+  a[199] = 3;
+  const std::vector<uint64_t> b(64, 0x123456789abcdefull);
+  ASSERT_EQ(BigInt::MultiplySchoolbook(BigInt::FromLimbs(a), BigInt::FromLimbs(b)),
+            BigInt::FromLimbs(a) * BigInt::FromLimbs(b));
+
+  std::mt19937_64 rng(4);
+  for (size_t zeros : {1, 20, 40, 100}) {
+    std::vector<uint64_t> x = Random(300, &rng).limbs();
+    std::vector<uint64_t> y = Random(70, &rng).limbs();
+    std::fill(x.begin() + 10, x.begin() + 10 + zeros, 0);
+    std::fill(y.begin() + 70 - std::min<size_t>(zeros, 35), y.end() - 1, 0);
+    const BigInt big = BigInt::FromLimbs(x);
+    const BigInt small = BigInt::FromLimbs(y);
+    ASSERT_EQ(BigInt::MultiplySchoolbook(big, small), big * small);
+    ASSERT_EQ(BigInt::MultiplySchoolbook(small, small), small * small);
+  }
+}
+
+TEST(big_int_add_sub) {
+  std::mt19937_64 rng(3);
+  BigInt a = Random(50, &rng);
+  const BigInt b = -Random(70, &rng);
+  ASSERT_EQ(a, (a + b) - b);
+  ASSERT_EQ(a + b, b + a);
+  ASSERT_TRUE((a + b).negative());
+  ASSERT_EQ((a << 1), a + a);
+  a -= a;
+  ASSERT_TRUE(a.is_zero());
+}
+
+}  // namespace bitwise
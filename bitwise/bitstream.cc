@@ -1,97 +1,147 @@
-
 #include "bitstream.h"
 
-#include "../base/logging.h"
+#include <algorithm>
 
-typedef std::queue<bool> BitBuffer;
-typedef unsigned char uchar;
+#include "async_sink.h"
 
 namespace bitstream {
-namespace internal {
 
-void PushByteToBuffer(uchar byte, BitBuffer* out) {
-  const static uchar left_most = 128;
-  for (int i = 0; i < 8; ++i) {
-    out->push(byte & left_most);
-    byte = byte << 1;
+BitOutStreamer::BitOutStreamer(std::ostream* output)
+    : owned_sink_(new OstreamSink(output)), sink_(owned_sink_.get()) {}
+
+BitOutStreamer::BitOutStreamer(ByteSink* sink) : sink_(sink) {}
+
+void BitOutStreamer::OutputRaw() {
+  if (cursor_ != region_ && region_ != overflow_.data()) {
+    sink_->Commit(cursor_ - region_);
   }
+  committed_ += cursor_ - region_;
+  region_ = cursor_ = limit_ = nullptr;
 }
 
-// Buffer will always contain less than 8 bits after this operation.
-void OutputRaw(BitBuffer* buffer, std::ostream* output) {
-  while (buffer->size() >= 8) {
-    uchar out_byte = '\000';
-    for(int i = 0; i < 8; ++i) {
-      out_byte = out_byte << 1;
-      bool is_one = buffer->front();
-      buffer->pop();
-      if (is_one) {
-        out_byte |= '\001';
-      }
-    }
-    (*output) << out_byte;
+void BitOutStreamer::NextRegion() {
+  OutputRaw();
+  size_t size = 0;
+  region_ = sink_->Reserve(max_buffer_size_ + 8, &size);
+  if (region_ == nullptr || size == 0) {
+    // Keeps accepting bits so callers only need to check ok() at the end.
+    dropped_bytes_ = true;
+    overflow_.resize(max_buffer_size_ + 8);
+    region_ = overflow_.data();
+    size = overflow_.size();
   }
+  cursor_ = region_;
+  limit_ = region_ + size;
 }
 
-void FlushRemaining(BitBuffer* buffer, std::ostream* output) {
-  OutputRaw(buffer, output);
-  // Now there is less than 8 bits left in the buffer.
-
-  // If buffer contained even 8 bits, return.
-  if (buffer->empty()) return;
-
-  // Output remaining bits followed by zeroes.
-  uchar out_byte = '\000';
-  int bits_left = 8;
-  while (!buffer->empty()) {
-    out_byte = out_byte << 1;
-    bool is_one = buffer->front();
-    buffer->pop();
-    if (is_one) {
-      out_byte |= '\001';
-    }
-    --bits_left;
-  }
-  if (bits_left <= 0) {
-    // Should never happen.
-    LOG(ERROR) << "While flushing, unexpected bits left: " << bits_left;
-    return;
+void BitOutStreamer::PushCompleteBytes() {
+  while (num_bits_ >= 8) {
+    num_bits_ -= 8;
+    PushCompleteByte(accumulator_ >> num_bits_);
   }
-  out_byte = out_byte << bits_left;
-  (*output) << out_byte;
 }
 
-}  // namespace internal
-
-BitOutStreamer::BitOutStreamer(std::ostream* output) : out_stream_(output) {}
-
 void BitOutStreamer::FlushRemaining() {
-  internal::FlushRemaining(&buffer_, out_stream_);
+  // If buffer contained even bytes, only the complete bytes are output.
+  if (num_bits_ > 0) {
+    // Output remaining bits followed by zeroes.
+    PushCompleteByte(accumulator_ << (8 - num_bits_));
+    num_bits_ = 0;
+  }
+  OutputRaw();
+  sink_->Flush();
 }
 
 void BitOutStreamer::SetBufferSize(size_t size) {
   if (size < 1) return;
   max_buffer_size_ = size;
+  if (IsTimeToOutput()) OutputRaw();
 }
 
-bool BitOutStreamer::IsTimeToOutput() const {
-  size_t max_bits = 8 * max_buffer_size_;
-  return buffer_.size() >= max_bits;
+void BitOutStreamer::SetAsync(size_t num_buffers) {
+  if (async_sink_ != nullptr) return;
+  OutputRaw();
+  async_sink_.reset(new AsyncSink(sink_, max_buffer_size_ + 8, num_buffers));
+  sink_ = async_sink_.get();
 }
 
-void BitOutStreamer::PushBit(bool bit) {
-  buffer_.push(bit);
-  if (IsTimeToOutput()) internal::OutputRaw(&buffer_, out_stream_);
+void BitOutStreamer::PushBytesAligned(const uint8_t* data, size_t size) {
+  if (!IsByteAligned()) {
+    // Slow path, 7 bytes per accumulator operation.
+    for (; size >= 8; size -= 7, data += 7) {
+      PushBitsFast(internal::LoadBigEndian64(data) >> 8, 56);
+    }
+    for (; size > 0; --size, ++data) {
+      PushByte(*data);
+    }
+    return;
+  }
+  if (size_t(cursor_ - region_) + size >= max_buffer_size_) {
+    // Would not fit in the buffer anyway, so bypass it.
+    OutputRaw();
+    if (!sink_->Write(data, size)) dropped_bytes_ = true;
+    committed_ += size;
+    return;
+  }
+  while (size > 0) {
+    if (cursor_ == limit_) NextRegion();
+    const size_t n = std::min(size, size_t(limit_ - cursor_));
+    memcpy(cursor_, data, n);
+    cursor_ += n;
+    data += n;
+    size -= n;
+  }
 }
 
-void BitOutStreamer::PushByte(uchar byte) {
-  for (int i = 7; i >= 0; --i) {
-    uchar bit_position = 1 << i;
-    buffer_.push(byte & bit_position);
+BitInStreamer::BitInStreamer(const uint8_t* data, size_t size)
+    : base_(data), next_(data), end_(data + size) {}
+
+BitInStreamer::BitInStreamer(std::istream* in) : in_stream_(in) {
+  buffer_.resize(1 << 16);
+  base_ = next_ = end_ = buffer_.data();
+}
+
+void BitInStreamer::SetBufferSize(size_t size) {
+  if (in_stream_ == nullptr || size < 8) return;
+  const size_t offset = next_ - base_;
+  const size_t unread = end_ - next_;
+  if (size < unread) return;
+  std::vector<uint8_t> buffer(size);
+  std::copy(next_, end_, buffer.begin());
+  buffer_.swap(buffer);
+  consumed_before_ += offset;
+  base_ = next_ = buffer_.data();
+  end_ = next_ + unread;
+}
+
+bool BitInStreamer::FillBuffer() {
+  if (in_stream_ == nullptr || !in_stream_->good()) return false;
+  const size_t unread = end_ - next_;
+  consumed_before_ += next_ - base_;
+  std::copy(next_, end_, buffer_.begin());
+  in_stream_->read(reinterpret_cast<char*>(buffer_.data() + unread), buffer_.size() - unread);
+  base_ = next_ = buffer_.data();
+  end_ = next_ + unread + in_stream_->gcount();
+  return in_stream_->gcount() > 0;
+}
+
+void BitInStreamer::Refill() {
+  if (end_ - next_ < 8) FillBuffer();
+  if (end_ - next_ >= 8) {
+    // Loads whole bytes until there are between 56 and 63 bits in the window.
+    window_ |= internal::LoadBigEndian64(next_) >> window_bits_;
+    next_ += (63 - window_bits_) >> 3;
+    window_bits_ |= 56;
+    return;
+  }
+  // Close to the end of input.
+  while (window_bits_ <= 56) {
+    if (next_ == end_ && !FillBuffer()) return;
+    window_ |= uint64_t(*next_) << (56 - window_bits_);
+    ++next_;
+    window_bits_ += 8;
   }
-  if (IsTimeToOutput()) internal::OutputRaw(&buffer_, out_stream_);
 }
 
 }  // namespace bitstream
 
-
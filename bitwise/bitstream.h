@@ -1,23 +1,56 @@
+
 #ifndef BITSTREAM_H_
 #define BITSTREAM_H_
 
+#include <cstdint>
+#include <cstring>
 #include <iostream>
-#include <queue>
+#include <memory>
+#include <vector>
+
+#include "byte_sink.h"
 
 namespace bitstream {
+namespace internal {
+inline uint64_t LoadBigEndian64(const uint8_t* bytes) {
+  uint64_t word;
+  memcpy(&word, bytes, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  word = __builtin_bswap64(word);
+#endif
+  return word;
+}
+
+inline void StoreBigEndian64(uint64_t word, uint8_t* bytes) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  word = __builtin_bswap64(word);
+#endif
+  memcpy(bytes, &word, sizeof(word));
+}
+}  // namespace internal
 
 // Operates on bit level, useful for compression where each token may be of different bit length.
 //
+// Bits are gathered in a 64-bit accumulator and moved as whole bytes into
+// memory reserved from a ByteSink, which is committed to the sink when full.
+//
 // Example:
 // 110, 00, 111011, FLUSH -> 1100 0111 0110 0000
 class BitOutStreamer {
  public:
+  // Largest number of bits PushBits handles in a single accumulator operation.
+  static const int kMaxFastBits = 56;
+
   explicit BitOutStreamer(std::ostream* out);
+  // Writes into `sink` which must outlive the streamer.
+  explicit BitOutStreamer(ByteSink* sink);
   ~BitOutStreamer() { FlushRemaining(); };
 
+  BitOutStreamer(const BitOutStreamer&) = delete;
+
   // Flush remaining bits. If the content is not evenly divisable by 8,
   // will output the last bits as most significant bits followed by zeros.
-  // Will always be empty after flushing.
+  // Will always be empty after flushing. Also flushes the sink.
   //
   // Example:
   // 1101 1001 110 -> 1101 1001 1100 0000
@@ -28,21 +61,221 @@ class BitOutStreamer {
   // Will output every time the buffer size is exceeded.
   void SetBufferSize(size_t size);
 
-  void PushBit(bool bit);
-  void PushByte(unsigned char byte);
+  // Writes to the sink on a background thread, see AsyncSink. The buffer
+  // size is fixed to the current one. FlushRemaining waits until all bytes
+  // are written and the destructor joins the thread.
+  void SetAsync(size_t num_buffers);
+
+  void PushBit(bool bit) {
+    accumulator_ = (accumulator_ << 1) | bit;
+    if (++num_bits_ == 8) {
+      num_bits_ = 0;
+      PushCompleteByte(accumulator_);
+    }
+  }
+
+  void PushByte(unsigned char byte) {
+    // num_bits_ < 8, so exactly one byte is completed.
+    accumulator_ = (accumulator_ << 8) | byte;
+    PushCompleteByte(accumulator_ >> num_bits_);
+  }
+
+  // Pushes the lowest `nbits` bits of `code`, most significant first.
+  // 0 <= nbits <= 64 and all bits of `code` above `nbits` must be zero.
+  //
+  // Example:
+  // PushBits(0x6, 3) is the same as PushBit(1), PushBit(1), PushBit(0).
+  void PushBits(uint64_t code, int nbits) {
+    if (nbits > kMaxFastBits) {
+      PushBitsFast(code >> 32, nbits - 32);
+      code &= 0xFFFFFFFF;
+      nbits = 32;
+    }
+    PushBitsFast(code, nbits);
+  }
+
+  // Pushes `size` whole bytes. Copies them straight to the buffer, or the
+  // sink for large inputs, when the stream is byte aligned.
+  void PushBytesAligned(const uint8_t* data, size_t size);
+
+  // Returns true iff the bits pushed so far fill whole bytes.
+  bool IsByteAligned() const { return num_bits_ == 0; }
+
+  // Pads with zeros up to the next byte boundary, like FlushRemaining but
+  // without flushing the sink.
+  void AlignToByte() {
+    if (num_bits_ > 0) PushBitsFast(0, 8 - num_bits_);
+  }
+
+  // Number of bits pushed so far.
+  uint64_t position() const {
+    return 8 * (committed_ + (cursor_ - region_)) + num_bits_;
+  }
 
   // Returns true iff the buffer is empty.
-  bool empty() const { return buffer_.empty(); }
+  bool empty() const { return num_bits_ == 0 && cursor_ == region_; }
+
+  // Returns false if bytes were dropped since the sink was full or failed.
+  bool ok() const { return !dropped_bytes_ && sink_->ok(); }
 
  private:
-  bool IsTimeToOutput() const;
+  void PushBitsFast(uint64_t code, int nbits) {
+    accumulator_ = (accumulator_ << nbits) | code;
+    num_bits_ += nbits;
+    if (num_bits_ < 8) return;
+    if (limit_ - cursor_ < 8) {
+      PushCompleteBytes();
+      return;
+    }
+    // Stores all pending bits left aligned, but only keeps the whole bytes.
+    uint8_t* const store_at = cursor_;
+    const uint64_t word = accumulator_ << (64 - num_bits_);
+    cursor_ += num_bits_ >> 3;
+    num_bits_ &= 7;
+    internal::StoreBigEndian64(word, store_at);
+    if (IsTimeToOutput()) OutputRaw();
+  }
+
+  void PushCompleteByte(uint8_t byte) {
+    if (cursor_ == limit_) NextRegion();
+    *cursor_ = byte;
+    ++cursor_;
+    if (IsTimeToOutput()) OutputRaw();
+  }
+
+  // Moves the whole bytes of the accumulator one at a time.
+  void PushCompleteBytes();
+
+  bool IsTimeToOutput() const { return size_t(cursor_ - region_) >= max_buffer_size_; }
+
+  // Commits all complete bytes to the sink and releases the region.
+  void OutputRaw();
+
+  // Reserves a new region from the sink, after committing the current one.
+  void NextRegion();
+
+  // Pending bits, right aligned: the next bit to output is at position num_bits_ - 1.
+  // Bits above that position are stale and ignored.
+  uint64_t accumulator_ = 0;
+  // Always less than 8 between calls.
+  int num_bits_ = 0;
+
+  // Complete bytes not yet committed are [region_, cursor_).
+  // The region is sink memory that ends at limit_.
+  uint8_t* region_ = nullptr;
+  uint8_t* cursor_ = nullptr;
+  uint8_t* limit_ = nullptr;
+  uint64_t committed_ = 0;  // Bytes before region_.
 
-  std::queue<bool> buffer_;
-  std::ostream* out_stream_;  // Not owned.
-  size_t max_buffer_size_ = 10;  // In bytes.
+  std::unique_ptr<ByteSink> owned_sink_;
+  // Wraps the previous sink, so must be destroyed before owned_sink_.
+  std::unique_ptr<ByteSink> async_sink_;
+  ByteSink* sink_;
+  // Used as region when the sink is full, its contents are dropped.
+  std::vector<uint8_t> overflow_;
+  bool dropped_bytes_ = false;
+  size_t max_buffer_size_ = 4096;  // In bytes.
 };
 
-// TODO also make a BitInStreamer ?
+// Reads bits in the format written by BitOutStreamer, most significant bit first.
+//
+// Bits are kept in a left aligned 64-bit window which is refilled from a byte
+// buffer up to 8 bytes at a time, so reading several bits costs the same as
+// reading one.
+//
+// Example:
+// 1100 0111 0110 0000 -> ReadBits(3) == 110, ReadBits(2) == 00, ReadBits(6) == 111011
+class BitInStreamer {
+ public:
+  // Largest number of bits for a single PeekBits or ReadBits call.
+  static const int kMaxBits = 56;
+
+  // Reads from memory. Does not copy, `data` must outlive the streamer.
+  BitInStreamer(const uint8_t* data, size_t size);
+  // Reads from the stream one buffer at a time.
+  explicit BitInStreamer(std::istream* in);
+
+  // Must not be copied since it may point into its own buffer.
+  BitInStreamer(const BitInStreamer&) = delete;
+
+  // Number of bytes to read from the stream at a time.
+  // Must be at least 8. Has no effect when reading from memory.
+  void SetBufferSize(size_t size);
+
+  // Returns the next `n` bits as the lowest bits of the result, without consuming them.
+  // 0 <= n <= kMaxBits. Bits past the end of the input read as zero.
+  uint64_t PeekBits(int n) {
+    if (window_bits_ < n) Refill();
+    // Two shifts since shifting by 64 is undefined for n == 0.
+    return (window_ >> 1) >> (63 - n);
+  }
+
+  // Consumes `n` bits which must have been peeked before.
+  // Consuming past the end of input sets overrun().
+  void ConsumeBits(int n) {
+    if (n > window_bits_) {
+      overrun_ = true;
+      n = window_bits_;
+    }
+    window_ <<= n;
+    window_bits_ -= n;
+  }
+
+  uint64_t ReadBits(int n) {
+    const uint64_t bits = PeekBits(n);
+    ConsumeBits(n);
+    return bits;
+  }
+
+  bool ReadBit() { return ReadBits(1); }
+
+  // Skips the remaining bits of the current byte, if any.
+  void AlignToByte() { ConsumeBits(window_bits_ & 7); }
+
+  // Returns true iff all bits have been consumed.
+  bool AtEnd() {
+    if (window_bits_ == 0) Refill();
+    return window_bits_ == 0;
+  }
+
+  // Returns true iff less than a byte remains and all remaining bits are zero,
+  // ie. what BitOutStreamer::FlushRemaining pads with. Also true at the end.
+  bool AtPadding() {
+    if (window_bits_ < 8) Refill();
+    return window_bits_ < 8 && window_ == 0;
+  }
+
+  // Returns true iff some read went past the end of the input.
+  bool overrun() const { return overrun_; }
+
+  // Number of bits consumed so far.
+  uint64_t position() const {
+    return 8 * (consumed_before_ + (next_ - base_)) - window_bits_;
+  }
+
+ private:
+  // Fills the window with at least 57 bits, or as many bits as remain.
+  void Refill();
+
+  // Moves the unread bytes to the front of buffer_ and reads more from the stream.
+  // Returns false if no more bytes could be read.
+  bool FillBuffer();
+
+  // Next bits to consume are the most significant bits.
+  // Bits past window_bits_ are either zero or equal to the upcoming input.
+  uint64_t window_ = 0;
+  int window_bits_ = 0;
+
+  // Unread bytes are [next_, end_).
+  const uint8_t* base_;
+  const uint8_t* next_;
+  const uint8_t* end_;
+  uint64_t consumed_before_ = 0;  // Bytes before base_.
+
+  std::istream* in_stream_ = nullptr;  // Not owned.
+  std::vector<uint8_t> buffer_;  // Only used when reading from a stream.
+  bool overrun_ = false;
+};
 
 }  // namespace bitstream
 
@@ -0,0 +1,241 @@
+
+#include "bitstream.h"
+
+#include <queue>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "../base/benchmark.h"
+
+namespace bitstream {
+namespace {
+
+// Discards everything written to it, so only the streamer itself is measured.
+class NullBuffer : public std::streambuf {
+ protected:
+  int overflow(int c) override { return c; }
+  std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+NullBuffer null_buffer;
+std::ostream null_stream(&null_buffer);
+
+// The previous queue<bool> based streamer, kept as the baseline.
+class QueueBitOutStreamer {
+ public:
+  explicit QueueBitOutStreamer(std::ostream* out) : out_stream_(out) {}
+  ~QueueBitOutStreamer() { FlushRemaining(); }
+
+  void PushBit(bool bit) {
+    buffer_.push(bit);
+    if (buffer_.size() >= 8 * max_buffer_size_) OutputRaw();
+  }
+
+  void PushByte(unsigned char byte) {
+    for (int i = 7; i >= 0; --i) {
+      unsigned char bit_position = 1 << i;
+      buffer_.push(byte & bit_position);
+    }
+    if (buffer_.size() >= 8 * max_buffer_size_) OutputRaw();
+  }
+
+  void FlushRemaining() {
+    OutputRaw();
+    if (buffer_.empty()) return;
+    unsigned char out_byte = '\000';
+    int bits_left = 8;
+    while (!buffer_.empty()) {
+      out_byte = (out_byte << 1) | buffer_.front();
+      buffer_.pop();
+      --bits_left;
+    }
+    (*out_stream_) << (unsigned char)(out_byte << bits_left);
+  }
+
+ private:
+  void OutputRaw() {
+    while (buffer_.size() >= 8) {
+      unsigned char out_byte = '\000';
+      for (int i = 0; i < 8; ++i) {
+        out_byte = (out_byte << 1) | buffer_.front();
+        buffer_.pop();
+      }
+      (*out_stream_) << out_byte;
+    }
+  }
+
+  std::queue<bool> buffer_;
+  std::ostream* out_stream_;
+  size_t max_buffer_size_ = 10;
+};
+
+const size_t kNumBytes = 1 << 16;
+
+const std::string& Text() {
+  static const std::string* text = [] {
+    std::string* result = new std::string();
+    while (result->size() < kNumBytes) {
+      *result += "abcdefg 1234 The quick brown fox jumps over the lazy dog. ";
+    }
+    result->resize(kNumBytes);
+    return result;
+  }();
+  return *text;
+}
+
+// Same shape as odd_bits_followed_by_zeroes: a 13 bit pattern repeated.
+const std::vector<int>& OddBits() {
+  static const std::vector<int> pattern = {0, 1, 1, 0, 0, 0, 0, 1, 0, 1, 1, 0, 1};
+  static const std::vector<int>* bits = [] {
+    std::vector<int>* result = new std::vector<int>();
+    while (result->size() < 8 * kNumBytes) {
+      result->insert(result->end(), pattern.begin(), pattern.end());
+    }
+    return result;
+  }();
+  return *bits;
+}
+
+template <typename Streamer>
+void PushBytes(const std::string& text) {
+  Streamer bit_stream(&null_stream);
+  for (char c : text) {
+    bit_stream.PushByte(c);
+  }
+  bit_stream.FlushRemaining();
+}
+
+template <typename Streamer>
+void PushBits(const std::vector<int>& bits) {
+  Streamer bit_stream(&null_stream);
+  for (int i : bits) {
+    bit_stream.PushBit(i == 1);
+  }
+  bit_stream.FlushRemaining();
+}
+
+// Mixes single bits with whole bytes so the stream is never byte aligned.
+template <typename Streamer>
+void PushMixed(const std::string& text) {
+  Streamer bit_stream(&null_stream);
+  for (char c : text) {
+    bit_stream.PushBit(c & 1);
+    bit_stream.PushByte(c);
+  }
+  bit_stream.FlushRemaining();
+}
+
+}  // namespace
+
+BENCHMARK(queue_push_byte) {
+  PushBytes<QueueBitOutStreamer>(Text());
+  SetItemsProcessed(8 * Text().size(), "bits");
+}
+
+BENCHMARK(accumulator_push_byte) {
+  PushBytes<BitOutStreamer>(Text());
+  SetItemsProcessed(8 * Text().size(), "bits");
+}
+
+BENCHMARK(queue_push_bit) {
+  PushBits<QueueBitOutStreamer>(OddBits());
+  SetItemsProcessed(OddBits().size(), "bits");
+}
+
+BENCHMARK(accumulator_push_bit) {
+  PushBits<BitOutStreamer>(OddBits());
+  SetItemsProcessed(OddBits().size(), "bits");
+}
+
+BENCHMARK(queue_push_mixed) {
+  PushMixed<QueueBitOutStreamer>(Text());
+  SetItemsProcessed(9 * Text().size(), "bits");
+}
+
+BENCHMARK(accumulator_push_mixed) {
+  PushMixed<BitOutStreamer>(Text());
+  SetItemsProcessed(9 * Text().size(), "bits");
+}
+
+// The 13 bit pattern pushed as one codeword instead of bit by bit.
+BENCHMARK(accumulator_push_bits_13) {
+  const size_t num_codes = OddBits().size() / 13;
+  BitOutStreamer bit_stream(&null_stream);
+  for (size_t i = 0; i < num_codes; ++i) {
+    bit_stream.PushBits(0x0C2D, 13);
+  }
+  bit_stream.FlushRemaining();
+  SetItemsProcessed(13 * num_codes, "bits");
+}
+
+BENCHMARK(vector_sink_push_bits_13) {
+  const size_t num_codes = OddBits().size() / 13;
+  static std::vector<uint8_t> bytes;
+  bytes.clear();
+  VectorSink sink(&bytes);
+  BitOutStreamer bit_stream(&sink);
+  for (size_t i = 0; i < num_codes; ++i) {
+    bit_stream.PushBits(0x0C2D, 13);
+  }
+  bit_stream.FlushRemaining();
+  SetItemsProcessed(13 * num_codes, "bits");
+}
+
+BENCHMARK(accumulator_push_bytes_aligned) {
+  BitOutStreamer bit_stream(&null_stream);
+  bit_stream.PushBytesAligned(reinterpret_cast<const uint8_t*>(Text().data()), Text().size());
+  bit_stream.FlushRemaining();
+  SetItemsProcessed(8 * Text().size(), "bits");
+}
+
+namespace {
+const std::string& Encoded() {
+  static const std::string* encoded = [] {
+    std::ostringstream output;
+    BitOutStreamer bit_stream(&output);
+    for (int i : OddBits()) {
+      bit_stream.PushBit(i == 1);
+    }
+    bit_stream.FlushRemaining();
+    return new std::string(output.str());
+  }();
+  return *encoded;
+}
+}  // namespace
+
+BENCHMARK(read_bit) {
+  BitInStreamer in(reinterpret_cast<const uint8_t*>(Encoded().data()), Encoded().size());
+  const size_t num_bits = OddBits().size();
+  uint64_t sum = 0;
+  for (size_t i = 0; i < num_bits; ++i) {
+    sum += in.ReadBit();
+  }
+  benchmark::DoNotOptimize(sum);
+  SetItemsProcessed(OddBits().size(), "bits");
+}
+
+BENCHMARK(read_bits_13) {
+  BitInStreamer in(reinterpret_cast<const uint8_t*>(Encoded().data()), Encoded().size());
+  const size_t num_reads = OddBits().size() / 13;
+  uint64_t sum = 0;
+  for (size_t i = 0; i < num_reads; ++i) {
+    sum += in.ReadBits(13);
+  }
+  benchmark::DoNotOptimize(sum);
+  SetItemsProcessed(OddBits().size(), "bits");
+}
+
+BENCHMARK(read_bits_stream) {
+  std::istringstream input(Encoded());
+  BitInStreamer in(&input);
+  uint64_t sum = 0;
+  while (!in.AtEnd()) {
+    sum += in.ReadBits(13);
+  }
+  benchmark::DoNotOptimize(sum);
+  SetItemsProcessed(OddBits().size(), "bits");
+}
+
+}  // namespace bitstream
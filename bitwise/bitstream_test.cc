@@ -134,4 +134,198 @@ TEST(flushes_on_destr) {
   ASSERT_EQ(input, output.str());
 }
 
+
+TEST(unaligned_bytes) {
+  os_stream output;
+  BitOutStreamer bit_stream(&output);
+
+  // 1 + 0xFF + 0 + 0x00 + 101 -> 1111 1111 1000 0000 0010 1000
+  bit_stream.PushBit(true);
+  bit_stream.PushByte('\xFF');
+  bit_stream.PushBit(false);
+  bit_stream.PushByte('\x00');
+  bit_stream.PushBit(true);
+  bit_stream.PushBit(false);
+  bit_stream.PushBit(true);
+  ASSERT_FALSE(bit_stream.empty());
+  bit_stream.FlushRemaining();
+
+  ASSERT_EQ("\xFF\x80\x28", output.str());
+  ASSERT_EMPTY(bit_stream);
+}
+
+
+TEST(read_bits_identity) {
+  const std::string input = "\xC7\x60";  // 1100 0111 0110 0000
+  BitInStreamer in(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+
+  ASSERT_EQ(6, in.PeekBits(3));
+  ASSERT_EQ(6, in.ReadBits(3));
+  ASSERT_EQ(0, in.ReadBits(2));
+  ASSERT_EQ(0x3B, in.ReadBits(6));  // 111011
+  ASSERT_EQ(11, in.position());
+  ASSERT_FALSE(in.AtEnd());
+  ASSERT_TRUE(in.AtPadding());
+
+  ASSERT_EQ(0, in.ReadBits(5));
+  ASSERT_TRUE(in.AtEnd());
+  ASSERT_FALSE(in.overrun());
+
+  ASSERT_FALSE(in.ReadBit());
+  ASSERT_TRUE(in.overrun());
+}
+
+TEST(read_written_bits) {
+  std::vector<int> bits;
+  os_stream output;
+  {
+    BitOutStreamer bit_stream(&output);
+    for (int i = 0; i < 1000; ++i) {
+      bits.push_back((i * 7) % 3 == 1);
+      bit_stream.PushBit(bits.back());
+    }
+  }
+  ASSERT_EQ(125, output.str().size());
+
+  std::istringstream input(output.str());
+  BitInStreamer in(&input);
+  in.SetBufferSize(16);
+  for (size_t i = 0; i < bits.size(); ++i) {
+    ASSERT_EQ(bits[i], in.ReadBit()) << "at bit " << i;
+  }
+  ASSERT_TRUE(in.AtEnd());
+  ASSERT_FALSE(in.overrun());
+}
+
+TEST(read_bytes_unaligned) {
+  const std::string input = "The quick brown fox jumps over the lazy dog";
+  os_stream output;
+  BitOutStreamer bit_stream(&output);
+  bit_stream.PushBit(true);
+  for (char c : input) {
+    bit_stream.PushByte(c);
+  }
+  bit_stream.FlushRemaining();
+
+  std::istringstream in_stream(output.str());
+  BitInStreamer in(&in_stream);
+  in.SetBufferSize(8);
+  ASSERT_TRUE(in.ReadBit());
+  std::string result;
+  while (!in.AtPadding()) {
+    result.push_back(in.ReadBits(8));
+  }
+  ASSERT_EQ(input, result);
+  ASSERT_EQ(1 + 8 * input.size(), in.position());
+
+  in.AlignToByte();
+  ASSERT_TRUE(in.AtEnd());
+  ASSERT_FALSE(in.overrun());
+}
+
+TEST(read_peek_past_end) {
+  const std::string input = "\xFF";
+  BitInStreamer in(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+  ASSERT_EQ(0xFF00, in.PeekBits(16));
+  ASSERT_EQ(0x1FE, in.PeekBits(9));
+  ASSERT_EQ(0, in.PeekBits(0));
+  ASSERT_FALSE(in.AtPadding());
+  in.ConsumeBits(4);
+  ASSERT_EQ(0xF, in.ReadBits(4));
+  ASSERT_TRUE(in.AtEnd());
+  ASSERT_TRUE(in.AtPadding());
+}
+
+
+TEST(push_bits_as_single_bits) {
+  os_stream bulk_output;
+  os_stream bit_output;
+  {
+    BitOutStreamer bulk(&bulk_output);
+    BitOutStreamer single(&bit_output);
+    bulk.SetBufferSize(7);
+    uint64_t value = 0x9E3779B97F4A7C15ull;
+    for (int i = 0; i < 500; ++i) {
+      const int nbits = i % 65;
+      const uint64_t code = nbits == 64 ? value : value & ((1ull << nbits) - 1);
+      bulk.PushBits(code, nbits);
+      for (int b = nbits - 1; b >= 0; --b) {
+        single.PushBit((code >> b) & 1);
+      }
+      value = value * 6364136223846793005ull + 1442695040888963407ull;
+    }
+  }
+  ASSERT_FALSE(bulk_output.str().empty());
+  ASSERT_EQ(bit_output.str(), bulk_output.str());
+}
+
+TEST(push_bits_codes) {
+  os_stream output;
+  BitOutStreamer bit_stream(&output);
+  // 110, 00, 111011, FLUSH -> 1100 0111 0110 0000
+  bit_stream.PushBits(6, 3);
+  bit_stream.PushBits(0, 2);
+  bit_stream.PushBits(0x3B, 6);
+  bit_stream.PushBits(0, 0);
+  bit_stream.FlushRemaining();
+  ASSERT_EQ("\xC7\x60", output.str());
+}
+
+TEST(push_bytes_aligned) {
+  const std::string input = "abcdefghijklmnopqrstuvwxyz";
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(input.data());
+  {
+    os_stream output;
+    BitOutStreamer bit_stream(&output);
+    bit_stream.SetBufferSize(8);
+    bit_stream.PushBytesAligned(data, 3);
+    ASSERT_EMPTY(output.str());
+    // Larger than the buffer, is written through.
+    bit_stream.PushBytesAligned(data + 3, input.size() - 3);
+    ASSERT_EQ(input, output.str());
+    ASSERT_EMPTY(bit_stream);
+  }
+  {
+    os_stream output;
+    BitOutStreamer bit_stream(&output);
+    bit_stream.PushBit(false);
+    ASSERT_FALSE(bit_stream.IsByteAligned());
+    bit_stream.PushBytesAligned(data, input.size());
+    bit_stream.PushBits(0x7F, 7);
+    ASSERT_TRUE(bit_stream.IsByteAligned());
+    bit_stream.FlushRemaining();
+
+    std::istringstream in_stream(output.str());
+    BitInStreamer in(&in_stream);
+    ASSERT_FALSE(in.ReadBit());
+    std::string result;
+    for (size_t i = 0; i < input.size(); ++i) {
+      result.push_back(in.ReadBits(8));
+    }
+    ASSERT_EQ(input, result);
+    ASSERT_EQ(0x7F, in.ReadBits(7));
+    ASSERT_TRUE(in.AtEnd());
+  }
+}
+
+
+TEST(position_and_align) {
+  os_stream output;
+  BitOutStreamer bit_stream(&output);
+  bit_stream.SetBufferSize(1);
+  ASSERT_EQ(0, bit_stream.position());
+  bit_stream.PushBits(0x5, 3);
+  ASSERT_EQ(3, bit_stream.position());
+  bit_stream.AlignToByte();
+  ASSERT_TRUE(bit_stream.IsByteAligned());
+  ASSERT_EQ(8, bit_stream.position());
+  bit_stream.AlignToByte();
+  ASSERT_EQ(8, bit_stream.position());
+  bit_stream.PushByte('a');
+  bit_stream.PushBit(true);
+  ASSERT_EQ(17, bit_stream.position());
+  bit_stream.FlushRemaining();
+  ASSERT_EQ("\xA0" "a" "\x80", output.str());
+}
+
 }
@@ -0,0 +1,125 @@
+#include "byte_sink.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "../base/logging.h"
+
+namespace bitstream {
+
+bool ByteSink::Write(const uint8_t* data, size_t size) {
+  while (size > 0) {
+    size_t available = 0;
+    uint8_t* memory = Reserve(size, &available);
+    if (memory == nullptr) return false;
+    const size_t n = std::min(size, available);
+    memcpy(memory, data, n);
+    Commit(n);
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+uint8_t* OstreamSink::Reserve(size_t size_hint, size_t* size) {
+  if (buffer_.size() < size_hint) buffer_.resize(size_hint);
+  *size = buffer_.size();
+  return buffer_.data();
+}
+
+void OstreamSink::Commit(size_t size) {
+  out_stream_->write(reinterpret_cast<const char*>(buffer_.data()), size);
+}
+
+bool OstreamSink::Write(const uint8_t* data, size_t size) {
+  out_stream_->write(reinterpret_cast<const char*>(data), size);
+  return out_stream_->good();
+}
+
+uint8_t* VectorSink::Reserve(size_t size_hint, size_t* size) {
+  if (out_->size() < committed_ + size_hint) {
+    // Grows geometrically so appending stays amortized O(1).
+    out_->resize(std::max(committed_ + size_hint, 2 * out_->size()));
+  }
+  *size = out_->size() - committed_;
+  return out_->data() + committed_;
+}
+
+uint8_t* SpanSink::Reserve(size_t /*size_hint*/, size_t* size) {
+  *size = capacity_ - size_;
+  if (*size == 0) return nullptr;
+  return data_ + size_;
+}
+
+namespace {
+const size_t kMinMapSize = 1 << 20;
+}  // namespace
+
+MmapFileSink::MmapFileSink(const std::string& path) {
+  fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    LOG(ERROR) << "Could not open " << path;
+    return;
+  }
+  ok_ = true;
+}
+
+MmapFileSink::~MmapFileSink() {
+  Flush();
+  Unmap();
+  if (fd_ >= 0) close(fd_);
+}
+
+void MmapFileSink::Unmap() {
+  if (map_ != nullptr) munmap(map_, mapped_size_);
+  map_ = nullptr;
+  mapped_size_ = 0;
+}
+
+bool MmapFileSink::Grow(size_t size) {
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  size = std::max(std::max(size, 2 * mapped_size_), kMinMapSize);
+  size = (size + page_size - 1) / page_size * page_size;
+  Unmap();
+  if (ftruncate(fd_, size) != 0) {
+    LOG(ERROR) << "Could not grow file to " << size << " bytes";
+    ok_ = false;
+    return false;
+  }
+  void* map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (map == MAP_FAILED) {
+    LOG(ERROR) << "Could not map " << size << " bytes";
+    ok_ = false;
+    return false;
+  }
+  map_ = static_cast<uint8_t*>(map);
+  mapped_size_ = size;
+  return true;
+}
+
+uint8_t* MmapFileSink::Reserve(size_t size_hint, size_t* size) {
+  *size = 0;
+  if (!ok_) return nullptr;
+  if (mapped_size_ < committed_ + size_hint && !Grow(committed_ + size_hint)) {
+    return nullptr;
+  }
+  *size = mapped_size_ - committed_;
+  return map_ + committed_;
+}
+
+void MmapFileSink::Flush() {
+  if (!ok_) return;
+  // The mapping must not be touched past the end of the file, so it is
+  // dropped and will be recreated by the next Reserve.
+  Unmap();
+  if (ftruncate(fd_, committed_) != 0) {
+    LOG(ERROR) << "Could not truncate file to " << committed_ << " bytes";
+    ok_ = false;
+  }
+}
+
+}  // namespace bitstream
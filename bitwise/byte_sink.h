@@ -0,0 +1,122 @@
+// Destinations for the bytes produced by bitstream::BitOutStreamer.
+//
+// The streamer asks the sink for writable memory, fills it in place and then
+// commits how much of it was used. Sinks that own the final memory, like
+// VectorSink and MmapFileSink, therefore receive the bytes without a copy.
+//
+// Example:
+// std::vector<uint8_t> bytes;
+// bitstream::VectorSink sink(&bytes);
+// bitstream::BitOutStreamer bit_stream(&sink);
+
+#ifndef BYTE_SINK_H_
+#define BYTE_SINK_H_
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace bitstream {
+
+class ByteSink {
+ public:
+  virtual ~ByteSink() {}
+
+  // Returns writable memory of at least one byte, ideally `size_hint` bytes,
+  // and sets `*size` to how many bytes are available.
+  // Returns nullptr if the sink cannot take any more bytes.
+  // The memory stays valid until the next call to Reserve, Commit or Write.
+  virtual uint8_t* Reserve(size_t size_hint, size_t* size) = 0;
+
+  // Appends the first `size` bytes of the memory from the last Reserve to the output.
+  virtual void Commit(size_t size) = 0;
+
+  // Makes all committed bytes visible at the final destination.
+  virtual void Flush() {}
+
+  // Appends a copy of `data`. Returns false if not everything fit.
+  virtual bool Write(const uint8_t* data, size_t size);
+
+  // Returns false if the sink failed, eg. could not open its file.
+  virtual bool ok() const { return true; }
+};
+
+// Writes to a std::ostream, one write() call per committed buffer.
+class OstreamSink : public ByteSink {
+ public:
+  explicit OstreamSink(std::ostream* out) : out_stream_(out) {}
+
+  uint8_t* Reserve(size_t size_hint, size_t* size) override;
+  void Commit(size_t size) override;
+  bool Write(const uint8_t* data, size_t size) override;
+
+ private:
+  std::ostream* out_stream_;  // Not owned.
+  std::vector<uint8_t> buffer_;
+};
+
+// Appends to a vector owned by the caller.
+// The vector may hold extra reserved bytes at its end until Flush.
+class VectorSink : public ByteSink {
+ public:
+  explicit VectorSink(std::vector<uint8_t>* out) : out_(out), committed_(out->size()) {}
+  ~VectorSink() { Flush(); }
+
+  uint8_t* Reserve(size_t size_hint, size_t* size) override;
+  void Commit(size_t size) override { committed_ += size; }
+  void Flush() override { out_->resize(committed_); }
+
+ private:
+  std::vector<uint8_t>* out_;  // Not owned.
+  size_t committed_;
+};
+
+// Writes into fixed memory owned by the caller.
+// Reserve returns nullptr once `capacity` bytes have been committed.
+class SpanSink : public ByteSink {
+ public:
+  SpanSink(uint8_t* data, size_t capacity) : data_(data), capacity_(capacity) {}
+
+  uint8_t* Reserve(size_t size_hint, size_t* size) override;
+  void Commit(size_t size) override { size_ += size; }
+
+  // Number of bytes committed.
+  size_t size() const { return size_; }
+
+ private:
+  uint8_t* data_;  // Not owned.
+  size_t capacity_;
+  size_t size_ = 0;
+};
+
+// Writes into a file through a shared memory mapping which grows with
+// ftruncate as needed. Flush truncates the file to the committed size.
+class MmapFileSink : public ByteSink {
+ public:
+  // Creates or truncates the file at `path`.
+  explicit MmapFileSink(const std::string& path);
+  ~MmapFileSink();
+
+  MmapFileSink(const MmapFileSink&) = delete;
+
+  uint8_t* Reserve(size_t size_hint, size_t* size) override;
+  void Commit(size_t size) override { committed_ += size; }
+  void Flush() override;
+  bool ok() const override { return ok_; }
+
+ private:
+  // Grows the file and mapping to hold at least `size` bytes.
+  bool Grow(size_t size);
+  void Unmap();
+
+  int fd_ = -1;
+  uint8_t* map_ = nullptr;
+  size_t mapped_size_ = 0;
+  size_t committed_ = 0;
+  bool ok_ = false;
+};
+
+}  // namespace bitstream
+
+#endif
@@ -0,0 +1,127 @@
+#include "byte_sink.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "bitstream.h"
+#include "../base/testing.h"
+
+namespace bitstream {
+namespace {
+const std::string kText = "The quick brown fox jumps over the lazy dog";
+
+void PushText(BitOutStreamer* bit_stream) {
+  bit_stream->PushBit(true);
+  for (char c : kText) {
+    bit_stream->PushByte(c);
+  }
+  bit_stream->PushBits(0x3F, 6);
+}
+
+std::string ExpectedText() {
+  std::ostringstream output;
+  BitOutStreamer bit_stream(&output);
+  PushText(&bit_stream);
+  bit_stream.FlushRemaining();
+  return output.str();
+}
+
+std::string AsString(const std::vector<uint8_t>& bytes) {
+  return std::string(bytes.begin(), bytes.end());
+}
+}  // namespace
+
+TEST(vector_sink) {
+  std::vector<uint8_t> bytes = {'>'};
+  {
+    VectorSink sink(&bytes);
+    BitOutStreamer bit_stream(&sink);
+    bit_stream.SetBufferSize(5);
+    PushText(&bit_stream);
+    bit_stream.FlushRemaining();
+    ASSERT_TRUE(bit_stream.ok());
+  }
+  ASSERT_EQ(">" + ExpectedText(), AsString(bytes));
+}
+
+TEST(vector_sink_large) {
+  std::vector<uint8_t> bytes;
+  std::string expected;
+  {
+    VectorSink sink(&bytes);
+    BitOutStreamer bit_stream(&sink);
+    for (int i = 0; i < 100000; ++i) {
+      bit_stream.PushByte(i);
+      expected.push_back(i);
+    }
+    bit_stream.PushBytesAligned(reinterpret_cast<const uint8_t*>(kText.data()), kText.size());
+    expected += kText;
+  }
+  ASSERT_EQ(expected, AsString(bytes));
+}
+
+TEST(span_sink) {
+  uint8_t memory[100];
+  SpanSink sink(memory, sizeof(memory));
+  {
+    BitOutStreamer bit_stream(&sink);
+    PushText(&bit_stream);
+    bit_stream.FlushRemaining();
+    ASSERT_TRUE(bit_stream.ok());
+  }
+  ASSERT_EQ(ExpectedText(), std::string(memory, memory + sink.size()));
+}
+
+TEST(span_sink_overflow) {
+  uint8_t memory[10];
+  SpanSink sink(memory, sizeof(memory));
+  BitOutStreamer bit_stream(&sink);
+  PushText(&bit_stream);
+  bit_stream.FlushRemaining();
+  ASSERT_FALSE(bit_stream.ok());
+  ASSERT_EQ(10, sink.size());
+  ASSERT_EQ(ExpectedText().substr(0, 10), std::string(memory, memory + sink.size()));
+}
+
+TEST(mmap_file_sink) {
+  const std::string path = "/tmp/byte_sink_test_mmap.bin";
+  std::string expected;
+  {
+    MmapFileSink sink(path);
+    ASSERT_TRUE(sink.ok());
+    BitOutStreamer bit_stream(&sink);
+    // Larger than the initial mapping so it has to grow.
+    for (int i = 0; i < 3000000; ++i) {
+      bit_stream.PushBits(i & 0x7FF, 11);
+    }
+    bit_stream.FlushRemaining();
+    ASSERT_TRUE(bit_stream.ok());
+  }
+  std::ifstream file(path, std::ios::binary);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  ASSERT_EQ((3000000 * 11 + 7) / 8, contents.str().size());
+
+  std::istringstream in_stream(contents.str());
+  BitInStreamer reader(&in_stream);
+  bool all_equal = true;
+  for (int i = 0; i < 3000000; ++i) {
+    all_equal &= reader.ReadBits(11) == uint64_t(i & 0x7FF);
+  }
+  ASSERT_TRUE(all_equal);
+  ASSERT_TRUE(reader.AtPadding());
+  remove(path.c_str());
+}
+
+TEST(mmap_file_sink_bad_path) {
+  MmapFileSink sink("/nonexistent_directory/file.bin");
+  ASSERT_FALSE(sink.ok());
+  BitOutStreamer bit_stream(&sink);
+  bit_stream.PushByte('a');
+  bit_stream.FlushRemaining();
+  ASSERT_FALSE(bit_stream.ok());
+}
+
+}  // namespace bitstream
@@ -0,0 +1,117 @@
+#include "chunked_bitstream.h"
+
+#include <algorithm>
+
+namespace bitstream {
+namespace {
+// Index entry plus footer sizes in bytes.
+const size_t kEntrySize = 16;
+const size_t kFooterSize = 24;
+}  // namespace
+
+ChunkedBitOutStreamer::ChunkedBitOutStreamer(ByteSink* sink, size_t chunk_size)
+    : bits_(sink), chunk_size_(std::max<size_t>(chunk_size, 1)) {
+  restart_points_.emplace_back();
+}
+
+ChunkedBitOutStreamer::ChunkedBitOutStreamer(std::ostream* out, size_t chunk_size)
+    : bits_(out), chunk_size_(std::max<size_t>(chunk_size, 1)) {
+  restart_points_.emplace_back();
+}
+
+ChunkedBitOutStreamer::~ChunkedBitOutStreamer() {
+  Finish();
+}
+
+void ChunkedBitOutStreamer::AddUncompressed(uint64_t size) {
+  uncompressed_size_ += size;
+  const uint64_t chunk_begin = restart_points_.back().compressed_offset;
+  if (bits_.position() < 8 * (chunk_begin + chunk_size_)) return;
+
+  bits_.AlignToByte();
+  RestartPoint restart;
+  restart.uncompressed_offset = uncompressed_size_;
+  restart.compressed_offset = bits_.position() / 8;
+  restart_points_.push_back(restart);
+}
+
+void ChunkedBitOutStreamer::Finish() {
+  if (finished_) return;
+  finished_ = true;
+  bits_.AlignToByte();
+  // A chunk started by the last AddUncompressed may be empty.
+  if (restart_points_.size() > 1 &&
+      restart_points_.back().compressed_offset == bits_.position() / 8) {
+    restart_points_.pop_back();
+  }
+  for (const RestartPoint& restart : restart_points_) {
+    bits_.PushBits(restart.uncompressed_offset, 64);
+    bits_.PushBits(restart.compressed_offset, 64);
+  }
+  bits_.PushBits(restart_points_.size(), 64);
+  bits_.PushBits(uncompressed_size_, 64);
+  bits_.PushBits(kChunkedMagic, 64);
+  bits_.FlushRemaining();
+}
+
+bool ChunkIndex::Parse(const uint8_t* data, size_t size) {
+  if (size < kFooterSize) return false;
+  const uint8_t* footer = data + size - kFooterSize;
+  const uint64_t num_chunks = internal::LoadBigEndian64(footer);
+  if (internal::LoadBigEndian64(footer + 16) != kChunkedMagic) return false;
+  if (num_chunks == 0 || num_chunks > (size - kFooterSize) / kEntrySize) return false;
+
+  data_ = data;
+  uncompressed_size_ = internal::LoadBigEndian64(footer + 8);
+  index_offset_ = size - kFooterSize - num_chunks * kEntrySize;
+  restart_points_.resize(num_chunks);
+  const uint8_t* entry = data + index_offset_;
+  for (RestartPoint& restart : restart_points_) {
+    restart.uncompressed_offset = internal::LoadBigEndian64(entry);
+    restart.compressed_offset = internal::LoadBigEndian64(entry + 8);
+    entry += kEntrySize;
+  }
+
+  // The first chunk starts the stream, so every offset falls in a chunk.
+  if (restart_points_[0].uncompressed_offset != 0 || restart_points_[0].compressed_offset != 0) {
+    return false;
+  }
+  // Offsets must be increasing and within bounds.
+  uint64_t last_uncompressed = 0;
+  uint64_t last_compressed = 0;
+  for (const RestartPoint& restart : restart_points_) {
+    if (restart.uncompressed_offset < last_uncompressed) return false;
+    if (restart.compressed_offset < last_compressed) return false;
+    last_uncompressed = restart.uncompressed_offset;
+    last_compressed = restart.compressed_offset;
+  }
+  return last_uncompressed <= uncompressed_size_ && last_compressed <= index_offset_;
+}
+
+uint64_t ChunkIndex::UncompressedSize(size_t chunk) const {
+  const uint64_t end = chunk + 1 < num_chunks()
+                           ? restart_points_[chunk + 1].uncompressed_offset
+                           : uncompressed_size_;
+  return end - restart_points_[chunk].uncompressed_offset;
+}
+
+const uint8_t* ChunkIndex::ChunkData(size_t chunk, size_t* size) const {
+  const uint64_t end = chunk + 1 < num_chunks()
+                           ? restart_points_[chunk + 1].compressed_offset
+                           : index_offset_;
+  *size = end - restart_points_[chunk].compressed_offset;
+  return data_ + restart_points_[chunk].compressed_offset;
+}
+
+size_t ChunkIndex::FindChunk(uint64_t offset) const {
+  if (offset >= uncompressed_size_) return num_chunks();
+  // Last chunk starting at or before offset. Empty chunks are skipped since
+  // the next chunk starts at the same offset.
+  auto it = std::upper_bound(restart_points_.begin(), restart_points_.end(), offset,
+                             [](uint64_t value, const RestartPoint& restart) {
+                               return value < restart.uncompressed_offset;
+                             });
+  return (it - restart_points_.begin()) - 1;
+}
+
+}  // namespace bitstream
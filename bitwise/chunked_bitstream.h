@@ -0,0 +1,102 @@
+// Seekable bitstream made of independently decodable chunks.
+//
+// The writer pads to a byte boundary at the first symbol boundary after
+// every `chunk_size` compressed bytes and remembers a restart point there.
+// Finish appends an index of all restart points, so a reader can jump to
+// the chunk holding any uncompressed offset and decode only that chunk, or
+// decode several chunks concurrently.
+//
+// Layout, all integers 64-bit big-endian:
+// [chunk 0][chunk 1]...[chunk N-1]
+// [uncompressed offset, compressed offset] x N
+// [N][uncompressed size][kChunkedMagic]
+//
+// Example:
+// ChunkedBitOutStreamer out(&sink, 1 << 16);
+// for (char c : text) {
+//   PushCode(c, out.bits());
+//   out.AddUncompressed(1);
+// }
+// out.Finish();
+
+#ifndef CHUNKED_BITSTREAM_H_
+#define CHUNKED_BITSTREAM_H_
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "bitstream.h"
+#include "byte_sink.h"
+
+namespace bitstream {
+
+const uint64_t kChunkedMagic = 0x4249545343484B31ull;  // "BITSCHK1"
+
+struct RestartPoint {
+  uint64_t uncompressed_offset = 0;
+  uint64_t compressed_offset = 0;  // In bytes from the start of the stream.
+};
+
+class ChunkedBitOutStreamer {
+ public:
+  // Starts a new chunk once the current one holds at least `chunk_size` bytes.
+  ChunkedBitOutStreamer(ByteSink* sink, size_t chunk_size);
+  ChunkedBitOutStreamer(std::ostream* out, size_t chunk_size);
+  // Calls Finish if not done already.
+  ~ChunkedBitOutStreamer();
+
+  // The streamer to push the encoded bits to.
+  BitOutStreamer* bits() { return &bits_; }
+
+  // Records that `size` more uncompressed bytes have been encoded.
+  // New chunks only start at these calls, so the caller must make them at
+  // symbol boundaries.
+  void AddUncompressed(uint64_t size);
+
+  // Pads the last chunk, writes the index and flushes.
+  // Nothing may be pushed afterwards.
+  void Finish();
+
+  const std::vector<RestartPoint>& restart_points() const { return restart_points_; }
+
+ private:
+  BitOutStreamer bits_;
+  const size_t chunk_size_;
+  uint64_t uncompressed_size_ = 0;
+  std::vector<RestartPoint> restart_points_;
+  bool finished_ = false;
+};
+
+// Reads the index of a chunked stream held in memory.
+class ChunkIndex {
+ public:
+  // Returns false if `data` does not end with a valid index.
+  // `data` must outlive the index.
+  bool Parse(const uint8_t* data, size_t size);
+
+  size_t num_chunks() const { return restart_points_.size(); }
+  uint64_t uncompressed_size() const { return uncompressed_size_; }
+  const RestartPoint& restart_point(size_t chunk) const { return restart_points_[chunk]; }
+
+  // Number of uncompressed bytes encoded in `chunk`.
+  uint64_t UncompressedSize(size_t chunk) const;
+
+  // Returns the encoded bits of `chunk`, and sets `*size` to their length in bytes.
+  // Decode them with BitInStreamer(data, size).
+  const uint8_t* ChunkData(size_t chunk, size_t* size) const;
+
+  // Returns the chunk holding the uncompressed byte at `offset`,
+  // or num_chunks() if `offset` is past the end.
+  size_t FindChunk(uint64_t offset) const;
+
+ private:
+  const uint8_t* data_ = nullptr;
+  uint64_t index_offset_ = 0;  // Where the chunks end.
+  uint64_t uncompressed_size_ = 0;
+  std::vector<RestartPoint> restart_points_;
+};
+
+}  // namespace bitstream
+
+#endif
@@ -0,0 +1,131 @@
+#include "chunked_bitstream.h"
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../base/testing.h"
+
+namespace bitstream {
+namespace {
+// ASCII text, so every symbol is coded in 7 bits.
+std::string Text(size_t size) {
+  std::string result;
+  for (size_t i = 0; i < size; ++i) {
+    result.push_back('a' + (i * i + i / 3) % 26);
+  }
+  return result;
+}
+
+std::vector<uint8_t> Encode(const std::string& text, size_t chunk_size) {
+  std::vector<uint8_t> bytes;
+  VectorSink sink(&bytes);
+  {
+    ChunkedBitOutStreamer out(&sink, chunk_size);
+    for (char c : text) {
+      out.bits()->PushBits(c, 7);
+      out.AddUncompressed(1);
+    }
+  }
+  sink.Flush();
+  return bytes;
+}
+
+std::string DecodeChunk(const ChunkIndex& index, size_t chunk) {
+  size_t size = 0;
+  const uint8_t* data = index.ChunkData(chunk, &size);
+  BitInStreamer in(data, size);
+  std::string result;
+  for (uint64_t i = 0; i < index.UncompressedSize(chunk); ++i) {
+    result.push_back(in.ReadBits(7));
+  }
+  return in.AtPadding() ? result : "Chunk not fully decoded";
+}
+}  // namespace
+
+TEST(chunked_single_chunk) {
+  const std::string text = Text(100);
+  const std::vector<uint8_t> bytes = Encode(text, 1 << 16);
+  // 700 bits in one chunk, one index entry and the footer.
+  ASSERT_EQ(88 + 16 + 24, bytes.size());
+
+  ChunkIndex index;
+  ASSERT_TRUE(index.Parse(bytes.data(), bytes.size()));
+  ASSERT_EQ(1, index.num_chunks());
+  ASSERT_EQ(100, index.uncompressed_size());
+  ASSERT_EQ(text, DecodeChunk(index, 0));
+}
+
+TEST(chunked_seek) {
+  const std::string text = Text(10000);
+  const std::vector<uint8_t> bytes = Encode(text, 100);
+
+  ChunkIndex index;
+  ASSERT_TRUE(index.Parse(bytes.data(), bytes.size()));
+  ASSERT_GT(index.num_chunks(), 80);
+  ASSERT_EQ(0, index.FindChunk(0));
+  ASSERT_EQ(index.num_chunks(), index.FindChunk(text.size()));
+
+  for (uint64_t offset : {0, 1, 114, 115, 5000, 9999}) {
+    const size_t chunk = index.FindChunk(offset);
+    const RestartPoint& restart = index.restart_point(chunk);
+    ASSERT_LE(restart.uncompressed_offset, offset);
+    ASSERT_LT(offset, restart.uncompressed_offset + index.UncompressedSize(chunk));
+    // Decodes the chunk without touching the ones before it.
+    const std::string decoded = DecodeChunk(index, chunk);
+    ASSERT_EQ(text[offset], decoded[offset - restart.uncompressed_offset]);
+  }
+}
+
+TEST(chunked_parallel_decode) {
+  const std::string text = Text(50000);
+  const std::vector<uint8_t> bytes = Encode(text, 1000);
+  ChunkIndex index;
+  ASSERT_TRUE(index.Parse(bytes.data(), bytes.size()));
+
+  std::vector<std::string> decoded(index.num_chunks());
+  std::vector<std::thread> threads;
+  const size_t num_threads = 4;
+  for (size_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&index, &decoded, t, num_threads] {
+      for (size_t chunk = t; chunk < index.num_chunks(); chunk += num_threads) {
+        decoded[chunk] = DecodeChunk(index, chunk);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  std::string result;
+  for (const std::string& chunk : decoded) {
+    result += chunk;
+  }
+  ASSERT_EQ(text, result);
+}
+
+TEST(chunked_empty) {
+  const std::vector<uint8_t> bytes = Encode("", 10);
+  ChunkIndex index;
+  ASSERT_TRUE(index.Parse(bytes.data(), bytes.size()));
+  ASSERT_EQ(1, index.num_chunks());
+  ASSERT_EQ(0, index.uncompressed_size());
+  ASSERT_EQ(index.num_chunks(), index.FindChunk(0));
+}
+
+TEST(chunked_invalid_index) {
+  std::vector<uint8_t> bytes = Encode(Text(1000), 50);
+  ChunkIndex index;
+  ASSERT_FALSE(index.Parse(bytes.data(), 10));
+  bytes.back() ^= 1;
+  ASSERT_FALSE(index.Parse(bytes.data(), bytes.size()));
+  bytes.back() ^= 1;
+
+  // First restart point past offset 0, which FindChunk could not place.
+  ASSERT_TRUE(index.Parse(bytes.data(), bytes.size()));
+  const size_t first_entry = bytes.size() - 24 - 16 * index.num_chunks();
+  bytes[first_entry + 7] = 1;
+  ASSERT_FALSE(index.Parse(bytes.data(), bytes.size()));
+}
+
+}  // namespace bitstream
@@ -0,0 +1,170 @@
+#include "morton.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define MORTON_BMI2_PATH 1
+#endif
+
+namespace bitwise {
+namespace {
+const uint64_t kEvenBits = 0x5555555555555555ull;
+const uint64_t kThirdBits = 0x1249249249249249ull;
+
+#if defined(MORTON_BMI2_PATH)
+// Compiled for BMI2 regardless of the build flags, and only called after the
+// runtime check. pdep is slow on AMD before Zen 3, but still correct.
+#define BMI2_FUNCTION __attribute__((target("bmi2")))
+
+BMI2_FUNCTION uint64_t EncodeMorton2D64Bmi2(uint32_t x, uint32_t y) {
+  return _pdep_u64(x, kEvenBits) | _pdep_u64(y, kEvenBits << 1);
+}
+
+BMI2_FUNCTION void DecodeMorton2D64Bmi2(uint64_t code, uint32_t* x, uint32_t* y) {
+  *x = _pext_u64(code, kEvenBits);
+  *y = _pext_u64(code, kEvenBits << 1);
+}
+
+BMI2_FUNCTION uint64_t EncodeMorton3D64Bmi2(uint32_t x, uint32_t y, uint32_t z) {
+  return _pdep_u64(x, kThirdBits) | _pdep_u64(y, kThirdBits << 1) |
+         _pdep_u64(z, kThirdBits << 2);
+}
+
+BMI2_FUNCTION void DecodeMorton3D64Bmi2(uint64_t code, uint32_t* x, uint32_t* y, uint32_t* z) {
+  *x = _pext_u64(code, kThirdBits);
+  *y = _pext_u64(code, kThirdBits << 1);
+  *z = _pext_u64(code, kThirdBits << 2);
+}
+
+BMI2_FUNCTION void EncodeMorton2D64Bmi2(const uint32_t* x, const uint32_t* y, size_t count,
+                                        uint64_t* codes) {
+  for (size_t i = 0; i < count; ++i) {
+    codes[i] = EncodeMorton2D64Bmi2(x[i], y[i]);
+  }
+}
+
+BMI2_FUNCTION void DecodeMorton2D64Bmi2(const uint64_t* codes, size_t count, uint32_t* x,
+                                        uint32_t* y) {
+  for (size_t i = 0; i < count; ++i) {
+    DecodeMorton2D64Bmi2(codes[i], x + i, y + i);
+  }
+}
+
+BMI2_FUNCTION void EncodeMorton3D64Bmi2(const uint32_t* x, const uint32_t* y, const uint32_t* z,
+                                        size_t count, uint64_t* codes) {
+  for (size_t i = 0; i < count; ++i) {
+    codes[i] = EncodeMorton3D64Bmi2(x[i], y[i], z[i]);
+  }
+}
+
+BMI2_FUNCTION void DecodeMorton3D64Bmi2(const uint64_t* codes, size_t count, uint32_t* x,
+                                        uint32_t* y, uint32_t* z) {
+  for (size_t i = 0; i < count; ++i) {
+    DecodeMorton3D64Bmi2(codes[i], x + i, y + i, z + i);
+  }
+}
+
+bool HasBmi2() {
+  static const bool has_bmi2 = [] {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("bmi2") != 0;
+  }();
+  return has_bmi2;
+}
+#else
+bool HasBmi2() {
+  return false;
+}
+#endif
+}  // namespace
+
+bool MortonUsesBmi2() {
+  return HasBmi2();
+}
+
+uint32_t EncodeMorton2D32(uint16_t x, uint16_t y) {
+  return EncodeMorton2D64(x, y);
+}
+
+void DecodeMorton2D32(uint32_t code, uint16_t* x, uint16_t* y) {
+  uint32_t x32;
+  uint32_t y32;
+  DecodeMorton2D64(code, &x32, &y32);
+  *x = x32;
+  *y = y32;
+}
+
+uint64_t EncodeMorton2D64(uint32_t x, uint32_t y) {
+#if defined(MORTON_BMI2_PATH)
+  if (HasBmi2()) return EncodeMorton2D64Bmi2(x, y);
+#endif
+  return internal::EncodeMorton2D64Portable(x, y);
+}
+
+void DecodeMorton2D64(uint64_t code, uint32_t* x, uint32_t* y) {
+#if defined(MORTON_BMI2_PATH)
+  if (HasBmi2()) return DecodeMorton2D64Bmi2(code, x, y);
+#endif
+  internal::DecodeMorton2D64Portable(code, x, y);
+}
+
+uint32_t EncodeMorton3D32(uint32_t x, uint32_t y, uint32_t z) {
+  return EncodeMorton3D64(x & 0x3FF, y & 0x3FF, z & 0x3FF);
+}
+
+void DecodeMorton3D32(uint32_t code, uint32_t* x, uint32_t* y, uint32_t* z) {
+  DecodeMorton3D64(code & 0x3FFFFFFF, x, y, z);
+}
+
+uint64_t EncodeMorton3D64(uint32_t x, uint32_t y, uint32_t z) {
+#if defined(MORTON_BMI2_PATH)
+  if (HasBmi2()) return EncodeMorton3D64Bmi2(x, y, z);
+#endif
+  return internal::EncodeMorton3D64Portable(x, y, z);
+}
+
+void DecodeMorton3D64(uint64_t code, uint32_t* x, uint32_t* y, uint32_t* z) {
+#if defined(MORTON_BMI2_PATH)
+  if (HasBmi2()) return DecodeMorton3D64Bmi2(code, x, y, z);
+#endif
+  internal::DecodeMorton3D64Portable(code, x, y, z);
+}
+
+void EncodeMorton2D64(const uint32_t* x, const uint32_t* y, size_t count, uint64_t* codes) {
+#if defined(MORTON_BMI2_PATH)
+  if (HasBmi2()) return EncodeMorton2D64Bmi2(x, y, count, codes);
+#endif
+  for (size_t i = 0; i < count; ++i) {
+    codes[i] = internal::EncodeMorton2D64Portable(x[i], y[i]);
+  }
+}
+
+void DecodeMorton2D64(const uint64_t* codes, size_t count, uint32_t* x, uint32_t* y) {
+#if defined(MORTON_BMI2_PATH)
+  if (HasBmi2()) return DecodeMorton2D64Bmi2(codes, count, x, y);
+#endif
+  for (size_t i = 0; i < count; ++i) {
+    internal::DecodeMorton2D64Portable(codes[i], x + i, y + i);
+  }
+}
+
+void EncodeMorton3D64(const uint32_t* x, const uint32_t* y, const uint32_t* z, size_t count,
+                      uint64_t* codes) {
+#if defined(MORTON_BMI2_PATH)
+  if (HasBmi2()) return EncodeMorton3D64Bmi2(x, y, z, count, codes);
+#endif
+  for (size_t i = 0; i < count; ++i) {
+    codes[i] = internal::EncodeMorton3D64Portable(x[i], y[i], z[i]);
+  }
+}
+
+void DecodeMorton3D64(const uint64_t* codes, size_t count, uint32_t* x, uint32_t* y,
+                      uint32_t* z) {
+#if defined(MORTON_BMI2_PATH)
+  if (HasBmi2()) return DecodeMorton3D64Bmi2(codes, count, x, y, z);
+#endif
+  for (size_t i = 0; i < count; ++i) {
+    internal::DecodeMorton3D64Portable(codes[i], x + i, y + i, z + i);
+  }
+}
+
+}  // namespace bitwise
@@ -0,0 +1,119 @@
+// Morton (Z-order) codes: the bits of 2 or 3 coordinates interleaved.
+//
+// Bit i of x goes to bit 2i of a 2D code, and y to bit 2i + 1. In 3D, x, y
+// and z go to bits 3i, 3i + 1 and 3i + 2. So sorting by code keeps nearby
+// points close together.
+//
+// Where the CPU has BMI2, checked once at runtime, the codes are built with
+// a single pdep or pext per coordinate. Elsewhere the portable magic-bits
+// versions below are used: log2(bits) shift, or and mask steps.
+//
+// Example:
+// uint64_t code = bitwise::EncodeMorton2D64(x, y);
+// bitwise::DecodeMorton2D64(code, &x, &y);
+
+#ifndef MORTON_H_
+#define MORTON_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bitwise {
+
+// 16-bit coordinates into 32 bits.
+uint32_t EncodeMorton2D32(uint16_t x, uint16_t y);
+void DecodeMorton2D32(uint32_t code, uint16_t* x, uint16_t* y);
+
+// 32-bit coordinates into 64 bits.
+uint64_t EncodeMorton2D64(uint32_t x, uint32_t y);
+void DecodeMorton2D64(uint64_t code, uint32_t* x, uint32_t* y);
+
+// The low 10 bits of each coordinate into 30 bits.
+uint32_t EncodeMorton3D32(uint32_t x, uint32_t y, uint32_t z);
+void DecodeMorton3D32(uint32_t code, uint32_t* x, uint32_t* y, uint32_t* z);
+
+// The low 21 bits of each coordinate into 63 bits.
+uint64_t EncodeMorton3D64(uint32_t x, uint32_t y, uint32_t z);
+void DecodeMorton3D64(uint64_t code, uint32_t* x, uint32_t* y, uint32_t* z);
+
+// Batch versions over `count` points, which dispatch once per call.
+void EncodeMorton2D64(const uint32_t* x, const uint32_t* y, size_t count, uint64_t* codes);
+void DecodeMorton2D64(const uint64_t* codes, size_t count, uint32_t* x, uint32_t* y);
+void EncodeMorton3D64(const uint32_t* x, const uint32_t* y, const uint32_t* z, size_t count,
+                      uint64_t* codes);
+void DecodeMorton3D64(const uint64_t* codes, size_t count, uint32_t* x, uint32_t* y,
+                      uint32_t* z);
+
+// Whether the pdep/pext versions are in use.
+bool MortonUsesBmi2();
+
+namespace internal {
+
+// Spreads the low 32 bits of x to the even bits.
+inline uint64_t SpreadBits2(uint64_t x) {
+  x &= 0xFFFFFFFFull;
+  x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+  x = (x | (x << 8)) & 0x00FF00FF00FF00FFull;
+  x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0Full;
+  x = (x | (x << 2)) & 0x3333333333333333ull;
+  x = (x | (x << 1)) & 0x5555555555555555ull;
+  return x;
+}
+
+// Inverse of SpreadBits2: gathers the even bits of x.
+inline uint64_t CompactBits2(uint64_t x) {
+  x &= 0x5555555555555555ull;
+  x = (x | (x >> 1)) & 0x3333333333333333ull;
+  x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+  x = (x | (x >> 4)) & 0x00FF00FF00FF00FFull;
+  x = (x | (x >> 8)) & 0x0000FFFF0000FFFFull;
+  x = (x | (x >> 16)) & 0x00000000FFFFFFFFull;
+  return x;
+}
+
+// Spreads the low 21 bits of x to every third bit.
+inline uint64_t SpreadBits3(uint64_t x) {
+  x &= 0x1FFFFFull;
+  x = (x | (x << 32)) & 0x001F00000000FFFFull;
+  x = (x | (x << 16)) & 0x001F0000FF0000FFull;
+  x = (x | (x << 8)) & 0x100F00F00F00F00Full;
+  x = (x | (x << 4)) & 0x10C30C30C30C30C3ull;
+  x = (x | (x << 2)) & 0x1249249249249249ull;
+  return x;
+}
+
+// Inverse of SpreadBits3.
+inline uint64_t CompactBits3(uint64_t x) {
+  x &= 0x1249249249249249ull;
+  x = (x | (x >> 2)) & 0x10C30C30C30C30C3ull;
+  x = (x | (x >> 4)) & 0x100F00F00F00F00Full;
+  x = (x | (x >> 8)) & 0x001F0000FF0000FFull;
+  x = (x | (x >> 16)) & 0x001F00000000FFFFull;
+  x = (x | (x >> 32)) & 0x1FFFFFull;
+  return x;
+}
+
+// Portable versions, used when BMI2 is missing.
+inline uint64_t EncodeMorton2D64Portable(uint32_t x, uint32_t y) {
+  return SpreadBits2(x) | (SpreadBits2(y) << 1);
+}
+
+inline void DecodeMorton2D64Portable(uint64_t code, uint32_t* x, uint32_t* y) {
+  *x = CompactBits2(code);
+  *y = CompactBits2(code >> 1);
+}
+
+inline uint64_t EncodeMorton3D64Portable(uint32_t x, uint32_t y, uint32_t z) {
+  return SpreadBits3(x) | (SpreadBits3(y) << 1) | (SpreadBits3(z) << 2);
+}
+
+inline void DecodeMorton3D64Portable(uint64_t code, uint32_t* x, uint32_t* y, uint32_t* z) {
+  *x = CompactBits3(code);
+  *y = CompactBits3(code >> 1);
+  *z = CompactBits3(code >> 2);
+}
+
+}  // namespace internal
+}  // namespace bitwise
+
+#endif
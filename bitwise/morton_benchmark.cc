@@ -0,0 +1,140 @@
+#include "morton.h"
+
+#include <vector>
+
+#include "../base/benchmark.h"
+
+namespace bitwise {
+namespace {
+const size_t kNumPoints = 1 << 14;
+
+// Interleaves one bit at a time, like MultPositive walks its bits.
+uint64_t EncodeMorton2D64Loop(uint32_t x, uint32_t y) {
+  uint64_t code = 0;
+  const int bits = sizeof(uint32_t) * 8;
+  for (int i = 0; i < bits; ++i) {
+    code |= uint64_t((x >> i) & 1) << (2 * i);
+    code |= uint64_t((y >> i) & 1) << (2 * i + 1);
+  }
+  return code;
+}
+
+void DecodeMorton2D64Loop(uint64_t code, uint32_t* x, uint32_t* y) {
+  *x = 0;
+  *y = 0;
+  const int bits = sizeof(uint32_t) * 8;
+  for (int i = 0; i < bits; ++i) {
+    *x |= uint32_t((code >> (2 * i)) & 1) << i;
+    *y |= uint32_t((code >> (2 * i + 1)) & 1) << i;
+  }
+}
+
+struct Points {
+  std::vector<uint32_t> x;
+  std::vector<uint32_t> y;
+  std::vector<uint32_t> z;
+  std::vector<uint64_t> codes;
+};
+
+Points* MakePoints() {
+  Points* points = new Points();
+  uint32_t value = 12345;
+  for (size_t i = 0; i < kNumPoints; ++i) {
+    value = value * 1103515245 + 12345;
+    points->x.push_back(value);
+    value = value * 1103515245 + 12345;
+    points->y.push_back(value);
+    points->z.push_back((value >> 7) & 0x1FFFFF);
+  }
+  points->codes.resize(kNumPoints);
+  for (size_t i = 0; i < kNumPoints; ++i) {
+    points->codes[i] = EncodeMorton2D64(points->x[i], points->y[i]);
+  }
+  return points;
+}
+
+Points& TestPoints() {
+  static Points* points = MakePoints();
+  return *points;
+}
+}  // namespace
+
+BENCHMARK(encode_2d_loop) {
+  Points& p = TestPoints();
+  for (size_t i = 0; i < kNumPoints; ++i) {
+    p.codes[i] = EncodeMorton2D64Loop(p.x[i], p.y[i]);
+  }
+  benchmark::DoNotOptimize(p.codes.data());
+  SetItemsProcessed(kNumPoints, "points");
+}
+
+BENCHMARK(encode_2d_portable) {
+  Points& p = TestPoints();
+  for (size_t i = 0; i < kNumPoints; ++i) {
+    p.codes[i] = internal::EncodeMorton2D64Portable(p.x[i], p.y[i]);
+  }
+  benchmark::DoNotOptimize(p.codes.data());
+  SetItemsProcessed(kNumPoints, "points");
+}
+
+BENCHMARK(encode_2d_single) {
+  Points& p = TestPoints();
+  for (size_t i = 0; i < kNumPoints; ++i) {
+    p.codes[i] = EncodeMorton2D64(p.x[i], p.y[i]);
+  }
+  benchmark::DoNotOptimize(p.codes.data());
+  SetItemsProcessed(kNumPoints, "points");
+}
+
+BENCHMARK(encode_2d_batch) {
+  Points& p = TestPoints();
+  EncodeMorton2D64(p.x.data(), p.y.data(), kNumPoints, p.codes.data());
+  benchmark::DoNotOptimize(p.codes.data());
+  SetItemsProcessed(kNumPoints, "points");
+}
+
+BENCHMARK(decode_2d_loop) {
+  Points& p = TestPoints();
+  std::vector<uint32_t> x(kNumPoints), y(kNumPoints);
+  for (size_t i = 0; i < kNumPoints; ++i) {
+    DecodeMorton2D64Loop(p.codes[i], &x[i], &y[i]);
+  }
+  benchmark::DoNotOptimize(x.data());
+  SetItemsProcessed(kNumPoints, "points");
+}
+
+BENCHMARK(decode_2d_portable) {
+  Points& p = TestPoints();
+  std::vector<uint32_t> x(kNumPoints), y(kNumPoints);
+  for (size_t i = 0; i < kNumPoints; ++i) {
+    internal::DecodeMorton2D64Portable(p.codes[i], &x[i], &y[i]);
+  }
+  benchmark::DoNotOptimize(x.data());
+  SetItemsProcessed(kNumPoints, "points");
+}
+
+BENCHMARK(decode_2d_batch) {
+  Points& p = TestPoints();
+  std::vector<uint32_t> x(kNumPoints), y(kNumPoints);
+  DecodeMorton2D64(p.codes.data(), kNumPoints, x.data(), y.data());
+  benchmark::DoNotOptimize(x.data());
+  SetItemsProcessed(kNumPoints, "points");
+}
+
+BENCHMARK(encode_3d_portable) {
+  Points& p = TestPoints();
+  for (size_t i = 0; i < kNumPoints; ++i) {
+    p.codes[i] = internal::EncodeMorton3D64Portable(p.x[i], p.y[i], p.z[i]);
+  }
+  benchmark::DoNotOptimize(p.codes.data());
+  SetItemsProcessed(kNumPoints, "points");
+}
+
+BENCHMARK(encode_3d_batch) {
+  Points& p = TestPoints();
+  EncodeMorton3D64(p.x.data(), p.y.data(), p.z.data(), kNumPoints, p.codes.data());
+  benchmark::DoNotOptimize(p.codes.data());
+  SetItemsProcessed(kNumPoints, "points");
+}
+
+}  // namespace bitwise
@@ -0,0 +1,106 @@
+#include "morton.h"
+
+#include <random>
+#include <vector>
+
+#include "../base/testing.h"
+
+namespace bitwise {
+namespace {
+// One bit at a time, as reference.
+uint64_t InterleaveLoop(const std::vector<uint32_t>& coordinates, int bits) {
+  const int dimensions = coordinates.size();
+  uint64_t code = 0;
+  for (int i = 0; i < bits; ++i) {
+    for (int d = 0; d < dimensions; ++d) {
+      code |= uint64_t((coordinates[d] >> i) & 1) << (dimensions * i + d);
+    }
+  }
+  return code;
+}
+}  // namespace
+
+TEST(morton_2d_known) {
+  ASSERT_EQ(0, EncodeMorton2D64(0, 0));
+  ASSERT_EQ(1, EncodeMorton2D64(1, 0));
+  ASSERT_EQ(2, EncodeMorton2D64(0, 1));
+  ASSERT_EQ(0xFFFFFFFFFFFFFFFFull, EncodeMorton2D64(0xFFFFFFFF, 0xFFFFFFFF));
+  ASSERT_EQ(0xAAAAAAAAu, EncodeMorton2D32(0, 0xFFFF));
+  ASSERT_EQ(0x7, EncodeMorton3D64(1, 1, 1));
+  ASSERT_EQ(0x7FFFFFFFFFFFFFFFull, EncodeMorton3D64(0x1FFFFF, 0x1FFFFF, 0x1FFFFF));
+}
+
+TEST(morton_random) {
+  std::mt19937 rng(1);
+  for (int i = 0; i < 10000; ++i) {
+    const uint32_t x = rng();
+    const uint32_t y = rng();
+    const uint32_t z = rng();
+
+    const uint64_t code2 = EncodeMorton2D64(x, y);
+    ASSERT_EQ(InterleaveLoop({x, y}, 32), code2);
+    ASSERT_EQ(code2, internal::EncodeMorton2D64Portable(x, y));
+    uint32_t dx, dy, dz;
+    DecodeMorton2D64(code2, &dx, &dy);
+    ASSERT_TRUE(dx == x && dy == y);
+    internal::DecodeMorton2D64Portable(code2, &dx, &dy);
+    ASSERT_TRUE(dx == x && dy == y);
+
+    const uint64_t code3 = EncodeMorton3D64(x, y, z);
+    ASSERT_EQ(InterleaveLoop({x, y, z}, 21), code3);
+    ASSERT_EQ(code3, internal::EncodeMorton3D64Portable(x, y, z));
+    DecodeMorton3D64(code3, &dx, &dy, &dz);
+    ASSERT_TRUE(dx == (x & 0x1FFFFF) && dy == (y & 0x1FFFFF) && dz == (z & 0x1FFFFF));
+    internal::DecodeMorton3D64Portable(code3, &dx, &dy, &dz);
+    ASSERT_TRUE(dx == (x & 0x1FFFFF) && dy == (y & 0x1FFFFF) && dz == (z & 0x1FFFFF));
+  }
+}
+
+TEST(morton_32) {
+  std::mt19937 rng(2);
+  for (int i = 0; i < 1000; ++i) {
+    const uint16_t x = rng();
+    const uint16_t y = rng();
+    uint16_t dx, dy;
+    DecodeMorton2D32(EncodeMorton2D32(x, y), &dx, &dy);
+    ASSERT_TRUE(dx == x && dy == y);
+
+    const uint32_t a = rng() & 0x3FF;
+    const uint32_t b = rng() & 0x3FF;
+    const uint32_t c = rng() & 0x3FF;
+    const uint32_t code = EncodeMorton3D32(a, b, c);
+    ASSERT_LT(code, 1u << 30);
+    uint32_t da, db, dc;
+    DecodeMorton3D32(code, &da, &db, &dc);
+    ASSERT_TRUE(da == a && db == b && dc == c);
+  }
+}
+
+TEST(morton_batch) {
+  std::mt19937 rng(3);
+  const size_t count = 1000;
+  std::vector<uint32_t> x(count), y(count), z(count);
+  for (size_t i = 0; i < count; ++i) {
+    x[i] = rng();
+    y[i] = rng();
+    z[i] = rng() & 0x1FFFFF;
+  }
+  std::vector<uint64_t> codes(count);
+  EncodeMorton2D64(x.data(), y.data(), count, codes.data());
+  ASSERT_EQ(EncodeMorton2D64(x[17], y[17]), codes[17]);
+  std::vector<uint32_t> dx(count), dy(count), dz(count);
+  DecodeMorton2D64(codes.data(), count, dx.data(), dy.data());
+  ASSERT_TRUE(dx == x && dy == y);
+
+  std::vector<uint32_t> y21(count);
+  for (size_t i = 0; i < count; ++i) {
+    x[i] &= 0x1FFFFF;
+    y21[i] = y[i] & 0x1FFFFF;
+  }
+  EncodeMorton3D64(x.data(), y21.data(), z.data(), count, codes.data());
+  ASSERT_EQ(EncodeMorton3D64(x[5], y21[5], z[5]), codes[5]);
+  DecodeMorton3D64(codes.data(), count, dx.data(), dy.data(), dz.data());
+  ASSERT_TRUE(dx == x && dy == y21 && dz == z);
+}
+
+}  // namespace bitwise
@@ -0,0 +1,131 @@
+#include "rank_select.h"
+
+#include "bitstream.h"
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+namespace bitwise {
+namespace {
+const size_t kWordsPerBlock = 8;  // 512 bits.
+const size_t kBlocksPerSuperblock = 128;  // 2^16 bits.
+const size_t kSelectSample = 4096;
+
+int Popcount(uint64_t word) {
+  return __builtin_popcountll(word);
+}
+
+// Position from the most significant bit of the one with rank k in `word`.
+int SelectInWord(uint64_t word, int k) {
+  // Same as the one with rank popcount - 1 - k counted from the least significant bit.
+  const int rank_from_low = Popcount(word) - 1 - k;
+#if defined(__BMI2__)
+  return 63 - __builtin_ctzll(_pdep_u64(uint64_t(1) << rank_from_low, word));
+#else
+  for (int i = 0; i < rank_from_low; ++i) {
+    word &= word - 1;  // Clears the lowest one.
+  }
+  return 63 - __builtin_ctzll(word);
+#endif
+}
+
+size_t NumBlocks(size_t num_bits) {
+  return num_bits / (64 * kWordsPerBlock) + 1;
+}
+}  // namespace
+
+RankSelect::RankSelect(const uint8_t* bytes, size_t num_bits) : num_bits_(num_bits) {
+  words_.resize(NumBlocks(num_bits) * kWordsPerBlock + 1);
+  const size_t num_bytes = (num_bits + 7) / 8;
+  size_t i = 0;
+  for (; i + 8 <= num_bytes; i += 8) {
+    words_[i / 8] = bitstream::internal::LoadBigEndian64(bytes + i);
+  }
+  for (; i < num_bytes; ++i) {
+    words_[i / 8] |= uint64_t(bytes[i]) << (56 - 8 * (i % 8));
+  }
+  // Clears bits past the end.
+  if (num_bits % 64 != 0) {
+    words_[num_bits / 64] &= ~uint64_t(0) << (64 - num_bits % 64);
+  }
+  Build();
+}
+
+RankSelect::RankSelect(const std::vector<bool>& bits) : num_bits_(bits.size()) {
+  words_.resize(NumBlocks(num_bits_) * kWordsPerBlock + 1);
+  for (size_t i = 0; i < bits.size(); ++i) {
+    if (bits[i]) words_[i / 64] |= uint64_t(1) << (63 - i % 64);
+  }
+  Build();
+}
+
+void RankSelect::Build() {
+  const size_t num_blocks = NumBlocks(num_bits_);
+  block_ranks_.resize(num_blocks);
+  super_ranks_.resize(num_blocks / kBlocksPerSuperblock + 1);
+  select_samples_.clear();
+
+  size_t ones = 0;
+  for (size_t block = 0; block < num_blocks; ++block) {
+    if (block % kBlocksPerSuperblock == 0) {
+      super_ranks_[block / kBlocksPerSuperblock] = ones;
+    }
+    block_ranks_[block] = ones - super_ranks_[block / kBlocksPerSuperblock];
+
+    size_t block_ones = 0;
+    for (size_t w = 0; w < kWordsPerBlock; ++w) {
+      block_ones += Popcount(words_[block * kWordsPerBlock + w]);
+    }
+    // Samples every block where a multiple of kSelectSample is passed.
+    while (select_samples_.size() * kSelectSample < ones + block_ones) {
+      select_samples_.push_back(block);
+    }
+    ones += block_ones;
+  }
+  num_ones_ = ones;
+  select_samples_.push_back(num_blocks - 1);
+}
+
+size_t RankSelect::Rank1(size_t i) const {
+  const size_t block = i / (64 * kWordsPerBlock);
+  size_t rank = BlockRank(block);
+  const size_t word = i / 64;
+  for (size_t w = block * kWordsPerBlock; w < word; ++w) {
+    rank += Popcount(words_[w]);
+  }
+  if (i % 64 != 0) rank += Popcount(words_[word] >> (64 - i % 64));
+  return rank;
+}
+
+size_t RankSelect::Select1(size_t k) const {
+  // The one lies in a block between two samples, found by binary search.
+  size_t low = select_samples_[k / kSelectSample];
+  size_t high = select_samples_[k / kSelectSample + 1];
+  // Invariant: BlockRank(low) <= k, and the one is in a block up to `high`.
+  while (low < high) {
+    const size_t mid = low + (high - low + 1) / 2;
+    if (BlockRank(mid) <= k) {
+      low = mid;
+    } else {
+      high = mid - 1;
+    }
+  }
+
+  size_t rest = k - BlockRank(low);
+  size_t word = low * kWordsPerBlock;
+  while (true) {
+    const size_t ones = Popcount(words_[word]);
+    if (rest < ones) break;
+    rest -= ones;
+    ++word;
+  }
+  return 64 * word + SelectInWord(words_[word], rest);
+}
+
+size_t RankSelect::MemoryUsage() const {
+  return words_.size() * sizeof(uint64_t) + super_ranks_.size() * sizeof(uint64_t) +
+         block_ranks_.size() * sizeof(uint16_t) + select_samples_.size() * sizeof(uint32_t);
+}
+
+}  // namespace bitwise
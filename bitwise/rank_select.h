@@ -0,0 +1,73 @@
+// Static succinct bitvector with rank and select.
+//
+// Bit i is stored the way BitOutStreamer writes it: byte i / 8, counting
+// from the most significant bit. So a bitvector can be built straight from
+// the bytes of a bitstream.
+//
+// Rank is O(1): a 64-bit count of ones per superblock of 2^16 bits, a 16-bit
+// count relative to the superblock per block of 512 bits, and popcount over
+// at most 8 words. Together that is about 3.2% extra space. Select samples
+// the block of every 4096th one, searches the blocks between two samples and
+// finishes with an in-word select (pdep and tzcnt where available).
+//
+// Example:
+// bitwise::RankSelect bits(bytes.data(), 8 * bytes.size());
+// size_t ones_before = bits.Rank1(100);
+// size_t third_one = bits.Select1(2);
+
+#ifndef RANK_SELECT_H_
+#define RANK_SELECT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bitwise {
+
+class RankSelect {
+ public:
+  // Copies the first `num_bits` bits of `bytes`.
+  RankSelect(const uint8_t* bytes, size_t num_bits);
+  explicit RankSelect(const std::vector<bool>& bits);
+
+  size_t size() const { return num_bits_; }
+  size_t num_ones() const { return num_ones_; }
+
+  bool Get(size_t i) const {
+    return (words_[i >> 6] >> (63 - (i & 63))) & 1;
+  }
+
+  // Number of ones in [0, i). 0 <= i <= size().
+  size_t Rank1(size_t i) const;
+  size_t Rank0(size_t i) const { return i - Rank1(i); }
+
+  // Position of the one with rank k, ie. Rank1(Select1(k)) == k.
+  // 0 <= k < num_ones().
+  size_t Select1(size_t k) const;
+
+  // Bytes used by the bits and the rank and select structures.
+  size_t MemoryUsage() const;
+
+ private:
+  // Fills the rank and select structures from words_.
+  void Build();
+
+  // Number of ones before block `block`.
+  size_t BlockRank(size_t block) const {
+    return super_ranks_[block >> 7] + block_ranks_[block];
+  }
+
+  size_t num_bits_;
+  size_t num_ones_ = 0;
+  // Bit i is bit 63 - i % 64 of words_[i / 64], ie. big-endian words.
+  // Padded with zero words to a whole block plus one word.
+  std::vector<uint64_t> words_;
+  std::vector<uint64_t> super_ranks_;
+  std::vector<uint16_t> block_ranks_;
+  // Block holding the one with rank j * kSelectSample, followed by the last block.
+  std::vector<uint32_t> select_samples_;
+};
+
+}  // namespace bitwise
+
+#endif
@@ -0,0 +1,99 @@
+#include "rank_select.h"
+
+#include <random>
+#include <vector>
+
+#include "../base/testing.h"
+#include "bitstream.h"
+
+namespace bitwise {
+namespace {
+std::vector<bool> RandomBits(size_t size, double density, int seed) {
+  std::mt19937 rng(seed);
+  std::bernoulli_distribution coin(density);
+  std::vector<bool> bits(size);
+  for (size_t i = 0; i < size; ++i) {
+    bits[i] = coin(rng);
+  }
+  return bits;
+}
+
+// Checks every rank and select against a linear scan.
+bool MatchesScan(const RankSelect& rank_select, const std::vector<bool>& bits) {
+  if (rank_select.size() != bits.size()) return false;
+  size_t ones = 0;
+  for (size_t i = 0; i < bits.size(); ++i) {
+    if (rank_select.Get(i) != bits[i]) return false;
+    if (rank_select.Rank1(i) != ones) return false;
+    if (bits[i]) {
+      if (rank_select.Select1(ones) != i) return false;
+      ++ones;
+    }
+  }
+  return rank_select.Rank1(bits.size()) == ones && rank_select.num_ones() == ones;
+}
+}  // namespace
+
+TEST(rank_select_small) {
+  const std::vector<bool> bits = {false, true, true, false, true};
+  RankSelect rank_select(bits);
+  ASSERT_EQ(3, rank_select.num_ones());
+  ASSERT_EQ(0, rank_select.Rank1(0));
+  ASSERT_EQ(0, rank_select.Rank1(1));
+  ASSERT_EQ(2, rank_select.Rank1(3));
+  ASSERT_EQ(3, rank_select.Rank1(5));
+  ASSERT_EQ(2, rank_select.Rank0(5));
+  ASSERT_EQ(1, rank_select.Select1(0));
+  ASSERT_EQ(4, rank_select.Select1(2));
+}
+
+TEST(rank_select_empty) {
+  RankSelect rank_select(std::vector<bool>{});
+  ASSERT_EQ(0, rank_select.size());
+  ASSERT_EQ(0, rank_select.num_ones());
+  ASSERT_EQ(0, rank_select.Rank1(0));
+}
+
+TEST(rank_select_random) {
+  // Sizes around the block and superblock boundaries.
+  for (size_t size : {63, 64, 511, 512, 513, 65535, 65536, 65537, 200000}) {
+    for (double density : {0.01, 0.5, 0.99}) {
+      const std::vector<bool> bits = RandomBits(size, density, size);
+      ASSERT_TRUE(MatchesScan(RankSelect(bits), bits));
+    }
+  }
+}
+
+TEST(rank_select_all_ones) {
+  const std::vector<bool> bits(140000, true);
+  RankSelect rank_select(bits);
+  ASSERT_TRUE(MatchesScan(rank_select, bits));
+  ASSERT_EQ(139999, rank_select.Select1(139999));
+}
+
+TEST(rank_select_sparse) {
+  // Long runs of zeros between the select samples.
+  std::vector<bool> bits(1 << 20);
+  for (size_t i = 7; i < bits.size(); i += 100003) {
+    bits[i] = true;
+  }
+  ASSERT_TRUE(MatchesScan(RankSelect(bits), bits));
+}
+
+TEST(rank_select_from_bitstream) {
+  const std::vector<bool> bits = RandomBits(1003, 0.3, 1);
+  std::vector<uint8_t> bytes;
+  bitstream::VectorSink sink(&bytes);
+  bitstream::BitOutStreamer out(&sink);
+  for (bool bit : bits) {
+    out.PushBit(bit);
+  }
+  out.FlushRemaining();
+
+  ASSERT_TRUE(MatchesScan(RankSelect(bytes.data(), bits.size()), bits));
+  // Padding and bits past the end are not counted.
+  bytes.back() |= 0x1F;
+  ASSERT_TRUE(MatchesScan(RankSelect(bytes.data(), bits.size()), bits));
+}
+
+}  // namespace bitwise
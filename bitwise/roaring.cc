@@ -0,0 +1,385 @@
+#include "roaring.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define ROARING_AVX2_PATH 1
+#endif
+
+namespace bitwise {
+namespace internal {
+
+bool RoaringContainer::Contains(uint16_t low) const {
+  switch (type) {
+    case kArray:
+      return std::binary_search(array.begin(), array.end(), low);
+    case kBitmap:
+      return (bitmap[low / 64] >> (low % 64)) & 1;
+    case kRun: {
+      // Last run starting at or before low.
+      auto it = std::upper_bound(runs.begin(), runs.end(), low,
+                                 [](uint16_t value, const RoaringRun& run) {
+                                   return value < run.start;
+                                 });
+      if (it == runs.begin()) return false;
+      --it;
+      return low - it->start <= it->length;
+    }
+  }
+  return false;
+}
+
+}  // namespace internal
+
+namespace {
+using internal::RoaringContainer;
+using internal::RoaringRun;
+
+// Arrays larger than this take more space than a bitmap.
+const size_t kMaxArraySize = 4096;
+const size_t kBitmapWords = 1024;
+
+void ToBitmap(RoaringContainer* c) {
+  if (c->type == RoaringContainer::kBitmap) return;
+  c->bitmap.assign(kBitmapWords, 0);
+  c->ForEach(0, [c](uint32_t low) { c->bitmap[low / 64] |= uint64_t(1) << (low % 64); });
+  c->type = RoaringContainer::kBitmap;
+  c->array.clear();
+  c->array.shrink_to_fit();
+  c->runs.clear();
+  c->runs.shrink_to_fit();
+}
+
+void ToArray(RoaringContainer* c) {
+  if (c->type == RoaringContainer::kArray) return;
+  std::vector<uint16_t> array;
+  array.reserve(c->cardinality);
+  c->ForEach(0, [&array](uint32_t low) { array.push_back(low); });
+  c->array = std::move(array);
+  c->type = RoaringContainer::kArray;
+  c->bitmap.clear();
+  c->bitmap.shrink_to_fit();
+  c->runs.clear();
+  c->runs.shrink_to_fit();
+}
+
+// Picks array or bitmap by cardinality.
+void Normalize(RoaringContainer* c) {
+  if (c->cardinality <= kMaxArraySize) {
+    ToArray(c);
+  } else {
+    ToBitmap(c);
+  }
+}
+
+// A copy of `c` as a bitmap, or `c` itself if already one.
+const RoaringContainer& AsBitmap(const RoaringContainer& c, RoaringContainer* scratch) {
+  if (c.type == RoaringContainer::kBitmap) return c;
+  *scratch = c;
+  ToBitmap(scratch);
+  return *scratch;
+}
+
+#if defined(ROARING_AVX2_PATH)
+// Compiled for AVX2 regardless of the build flags, and only called after the
+// runtime check.
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+
+struct AndWords {
+  static uint64_t Word(uint64_t a, uint64_t b) { return a & b; }
+#if defined(ROARING_AVX2_PATH)
+  AVX2_FUNCTION static __m256i Vector(__m256i a, __m256i b) { return _mm256_and_si256(a, b); }
+#endif
+};
+
+struct OrWords {
+  static uint64_t Word(uint64_t a, uint64_t b) { return a | b; }
+#if defined(ROARING_AVX2_PATH)
+  AVX2_FUNCTION static __m256i Vector(__m256i a, __m256i b) { return _mm256_or_si256(a, b); }
+#endif
+};
+
+struct AndNotWords {
+  static uint64_t Word(uint64_t a, uint64_t b) { return a & ~b; }
+#if defined(ROARING_AVX2_PATH)
+  AVX2_FUNCTION static __m256i Vector(__m256i a, __m256i b) { return _mm256_andnot_si256(b, a); }
+#endif
+};
+
+struct XorWords {
+  static uint64_t Word(uint64_t a, uint64_t b) { return a ^ b; }
+#if defined(ROARING_AVX2_PATH)
+  AVX2_FUNCTION static __m256i Vector(__m256i a, __m256i b) { return _mm256_xor_si256(a, b); }
+#endif
+};
+
+#if defined(ROARING_AVX2_PATH)
+bool HasAvx2() {
+  static const bool has_avx2 = [] {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+  }();
+  return has_avx2;
+}
+
+template <typename Words>
+AVX2_FUNCTION void CombineBitmapsAvx2(const uint64_t* a, const uint64_t* b, uint64_t* out) {
+  for (size_t i = 0; i < kBitmapWords; i += 4) {
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+    const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), Words::Vector(x, y));
+  }
+}
+#endif
+
+uint32_t BitmapCardinality(const uint64_t* bitmap) {
+  uint32_t cardinality = 0;
+  for (size_t i = 0; i < kBitmapWords; ++i) {
+    cardinality += __builtin_popcountll(bitmap[i]);
+  }
+  return cardinality;
+}
+
+// Combines two bitmaps into `out` and returns its cardinality.
+template <typename Words>
+uint32_t CombineBitmaps(const uint64_t* a, const uint64_t* b, uint64_t* out) {
+#if defined(ROARING_AVX2_PATH)
+  if (HasAvx2()) {
+    CombineBitmapsAvx2<Words>(a, b, out);
+    return BitmapCardinality(out);
+  }
+#endif
+  for (size_t i = 0; i < kBitmapWords; ++i) {
+    out[i] = Words::Word(a[i], b[i]);
+  }
+  return BitmapCardinality(out);
+}
+
+// Merges two sorted arrays, keeping values according to where they occur.
+std::vector<uint16_t> MergeArrays(const std::vector<uint16_t>& a, const std::vector<uint16_t>& b,
+                                  bool keep_only_a, bool keep_only_b, bool keep_both) {
+  std::vector<uint16_t> result;
+  result.reserve(keep_only_a || keep_only_b ? a.size() + b.size() : std::min(a.size(), b.size()));
+  size_t i = 0;
+  size_t j = 0;
+  while (i < a.size() && j < b.size()) {
+    if (a[i] < b[j]) {
+      if (keep_only_a) result.push_back(a[i]);
+      ++i;
+    } else if (b[j] < a[i]) {
+      if (keep_only_b) result.push_back(b[j]);
+      ++j;
+    } else {
+      if (keep_both) result.push_back(a[i]);
+      ++i;
+      ++j;
+    }
+  }
+  if (keep_only_a) result.insert(result.end(), a.begin() + i, a.end());
+  if (keep_only_b) result.insert(result.end(), b.begin() + j, b.end());
+  return result;
+}
+
+// Values of array `a` that are (not) in `b`.
+RoaringContainer FilterArray(const RoaringContainer& a, const RoaringContainer& b, bool in_b) {
+  RoaringContainer result;
+  for (uint16_t low : a.array) {
+    if (b.Contains(low) == in_b) result.array.push_back(low);
+  }
+  result.cardinality = result.array.size();
+  return result;
+}
+}  // namespace
+
+RoaringBitmap RoaringBitmap::FromValues(std::vector<uint32_t> values) {
+  std::sort(values.begin(), values.end());
+  RoaringBitmap result;
+  // Sorted values always append to the last container.
+  for (uint32_t value : values) {
+    result.Add(value);
+  }
+  return result;
+}
+
+std::vector<uint32_t> RoaringBitmap::ToVector() const {
+  std::vector<uint32_t> values;
+  values.reserve(Cardinality());
+  ForEach([&values](uint32_t value) { values.push_back(value); });
+  return values;
+}
+
+void RoaringBitmap::Add(uint32_t value) {
+  const uint16_t high = value >> 16;
+  const uint16_t low = value & 0xFFFF;
+  auto it = std::lower_bound(keys_.begin(), keys_.end(), high);
+  const size_t index = it - keys_.begin();
+  if (it == keys_.end() || *it != high) {
+    keys_.insert(it, high);
+    containers_.insert(containers_.begin() + index, RoaringContainer());
+  }
+
+  RoaringContainer& c = containers_[index];
+  if (c.type == RoaringContainer::kRun) {
+    if (c.Contains(low)) return;
+    Normalize(&c);
+  }
+  if (c.type == RoaringContainer::kArray) {
+    if (c.array.empty() || c.array.back() < low) {
+      c.array.push_back(low);
+    } else {
+      auto pos = std::lower_bound(c.array.begin(), c.array.end(), low);
+      if (*pos == low) return;
+      c.array.insert(pos, low);
+    }
+    ++c.cardinality;
+    if (c.cardinality > kMaxArraySize) ToBitmap(&c);
+  } else {
+    uint64_t& word = c.bitmap[low / 64];
+    const uint64_t bit = uint64_t(1) << (low % 64);
+    if (word & bit) return;
+    word |= bit;
+    ++c.cardinality;
+  }
+}
+
+bool RoaringBitmap::Contains(uint32_t value) const {
+  auto it = std::lower_bound(keys_.begin(), keys_.end(), uint16_t(value >> 16));
+  if (it == keys_.end() || *it != (value >> 16)) return false;
+  return containers_[it - keys_.begin()].Contains(value & 0xFFFF);
+}
+
+size_t RoaringBitmap::Cardinality() const {
+  size_t result = 0;
+  for (const RoaringContainer& c : containers_) {
+    result += c.cardinality;
+  }
+  return result;
+}
+
+void RoaringBitmap::RunOptimize() {
+  for (RoaringContainer& c : containers_) {
+    std::vector<RoaringRun> runs;
+    c.ForEach(0, [&runs](uint32_t low) {
+      if (!runs.empty() && uint32_t(runs.back().start + runs.back().length + 1) == low) {
+        ++runs.back().length;
+      } else {
+        runs.push_back(RoaringRun{uint16_t(low), 0});
+      }
+    });
+    const size_t current_size = c.type == RoaringContainer::kBitmap
+                                    ? kBitmapWords * sizeof(uint64_t)
+                                    : c.cardinality * sizeof(uint16_t);
+    if (runs.size() * sizeof(RoaringRun) < current_size) {
+      c.type = RoaringContainer::kRun;
+      c.runs = std::move(runs);
+      c.array.clear();
+      c.array.shrink_to_fit();
+      c.bitmap.clear();
+      c.bitmap.shrink_to_fit();
+    } else if (c.type == RoaringContainer::kRun) {
+      Normalize(&c);
+    }
+  }
+}
+
+size_t RoaringBitmap::MemoryUsage() const {
+  size_t result = keys_.capacity() * sizeof(uint16_t) +
+                  containers_.capacity() * sizeof(RoaringContainer);
+  for (const RoaringContainer& c : containers_) {
+    result += c.array.capacity() * sizeof(uint16_t) + c.bitmap.capacity() * sizeof(uint64_t) +
+              c.runs.capacity() * sizeof(RoaringRun);
+  }
+  return result;
+}
+
+RoaringBitmap RoaringBitmap::And(const RoaringBitmap& a, const RoaringBitmap& b) {
+  return Combine(a, b, kAnd);
+}
+
+RoaringBitmap RoaringBitmap::Or(const RoaringBitmap& a, const RoaringBitmap& b) {
+  return Combine(a, b, kOr);
+}
+
+RoaringBitmap RoaringBitmap::AndNot(const RoaringBitmap& a, const RoaringBitmap& b) {
+  return Combine(a, b, kAndNot);
+}
+
+RoaringBitmap RoaringBitmap::Xor(const RoaringBitmap& a, const RoaringBitmap& b) {
+  return Combine(a, b, kXor);
+}
+
+RoaringBitmap RoaringBitmap::Combine(const RoaringBitmap& a, const RoaringBitmap& b, SetOp op) {
+  const bool keep_only_a = op != kAnd;
+  const bool keep_only_b = op == kOr || op == kXor;
+  const bool keep_both = op == kAnd || op == kOr;
+
+  RoaringBitmap result;
+  size_t i = 0;
+  size_t j = 0;
+  while (i < a.keys_.size() || j < b.keys_.size()) {
+    const bool has_a = i < a.keys_.size();
+    const bool has_b = j < b.keys_.size();
+    if (has_a && (!has_b || a.keys_[i] < b.keys_[j])) {
+      if (keep_only_a) {
+        result.keys_.push_back(a.keys_[i]);
+        result.containers_.push_back(a.containers_[i]);
+      }
+      ++i;
+      continue;
+    }
+    if (has_b && (!has_a || b.keys_[j] < a.keys_[i])) {
+      if (keep_only_b) {
+        result.keys_.push_back(b.keys_[j]);
+        result.containers_.push_back(b.containers_[j]);
+      }
+      ++j;
+      continue;
+    }
+
+    // Same chunk in both.
+    const RoaringContainer& x = a.containers_[i];
+    const RoaringContainer& y = b.containers_[j];
+    RoaringContainer c;
+    if (x.type == RoaringContainer::kArray && y.type == RoaringContainer::kArray) {
+      c.array = MergeArrays(x.array, y.array, keep_only_a, keep_only_b, keep_both);
+      c.cardinality = c.array.size();
+    } else if (x.type == RoaringContainer::kArray && (op == kAnd || op == kAndNot)) {
+      c = FilterArray(x, y, op == kAnd);
+    } else if (y.type == RoaringContainer::kArray && op == kAnd) {
+      c = FilterArray(y, x, true);
+    } else {
+      RoaringContainer x_scratch;
+      RoaringContainer y_scratch;
+      const uint64_t* x_words = AsBitmap(x, &x_scratch).bitmap.data();
+      const uint64_t* y_words = AsBitmap(y, &y_scratch).bitmap.data();
+      c.type = RoaringContainer::kBitmap;
+      c.bitmap.resize(kBitmapWords);
+      switch (op) {
+        case kAnd:
+          c.cardinality = CombineBitmaps<AndWords>(x_words, y_words, c.bitmap.data());
+          break;
+        case kOr:
+          c.cardinality = CombineBitmaps<OrWords>(x_words, y_words, c.bitmap.data());
+          break;
+        case kAndNot:
+          c.cardinality = CombineBitmaps<AndNotWords>(x_words, y_words, c.bitmap.data());
+          break;
+        case kXor:
+          c.cardinality = CombineBitmaps<XorWords>(x_words, y_words, c.bitmap.data());
+          break;
+      }
+    }
+    if (c.cardinality > 0) {
+      Normalize(&c);
+      result.keys_.push_back(a.keys_[i]);
+      result.containers_.push_back(std::move(c));
+    }
+    ++i;
+    ++j;
+  }
+  return result;
+}
+
+}  // namespace bitwise
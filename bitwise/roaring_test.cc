@@ -0,0 +1,123 @@
+#include "roaring.h"
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+#include "../base/testing.h"
+#include "../graph/connected.h"
+
+namespace bitwise {
+namespace {
+// Sparse chunks, dense chunks and long runs.
+std::vector<uint32_t> MixedValues(int seed) {
+  std::mt19937 rng(seed);
+  std::vector<uint32_t> values;
+  for (int i = 0; i < 3000; ++i) {
+    values.push_back(rng() % (1 << 16));
+  }
+  for (int i = 0; i < 30000; ++i) {
+    values.push_back((1 << 16) + rng() % (1 << 16));
+  }
+  const uint32_t run_start = (5 << 16) + rng() % 1000;
+  for (uint32_t v = run_start; v < run_start + 20000; ++v) {
+    values.push_back(v);
+  }
+  values.push_back(0xFFFFFFFF);
+  std::sort(values.begin(), values.end());
+  values.erase(std::unique(values.begin(), values.end()), values.end());
+  return values;
+}
+
+std::vector<uint32_t> Expected(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b,
+                               char op) {
+  std::vector<uint32_t> result;
+  auto out = std::back_inserter(result);
+  switch (op) {
+    case '&':
+      std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), out);
+      break;
+    case '|':
+      std::set_union(a.begin(), a.end(), b.begin(), b.end(), out);
+      break;
+    case '-':
+      std::set_difference(a.begin(), a.end(), b.begin(), b.end(), out);
+      break;
+    case '^':
+      std::set_symmetric_difference(a.begin(), a.end(), b.begin(), b.end(), out);
+      break;
+  }
+  return result;
+}
+
+bool OpsMatch(const RoaringBitmap& a, const RoaringBitmap& b) {
+  const std::vector<uint32_t> x = a.ToVector();
+  const std::vector<uint32_t> y = b.ToVector();
+  return RoaringBitmap::And(a, b).ToVector() == Expected(x, y, '&') &&
+         RoaringBitmap::Or(a, b).ToVector() == Expected(x, y, '|') &&
+         RoaringBitmap::AndNot(a, b).ToVector() == Expected(x, y, '-') &&
+         RoaringBitmap::Xor(a, b).ToVector() == Expected(x, y, '^');
+}
+}  // namespace
+
+TEST(roaring_add_contains) {
+  RoaringBitmap bitmap;
+  ASSERT_TRUE(bitmap.empty());
+  bitmap.Add(7);
+  bitmap.Add(1 << 20);
+  bitmap.Add(7);
+  bitmap.Add(3);
+  ASSERT_EQ(3, bitmap.Cardinality());
+  ASSERT_TRUE(bitmap.Contains(3));
+  ASSERT_TRUE(bitmap.Contains(1 << 20));
+  ASSERT_FALSE(bitmap.Contains(4));
+  ASSERT_FALSE(bitmap.Contains(1 << 19));
+  const std::vector<uint32_t> expected = {3, 7, 1 << 20};
+  ASSERT_TRUE(bitmap.ToVector() == expected);
+}
+
+TEST(roaring_containers) {
+  const std::vector<uint32_t> values = MixedValues(1);
+  RoaringBitmap bitmap = RoaringBitmap::FromValues(values);
+  ASSERT_EQ(values.size(), bitmap.Cardinality());
+  ASSERT_TRUE(bitmap.ToVector() == values);
+  const size_t before = bitmap.MemoryUsage();
+
+  bitmap.RunOptimize();
+  ASSERT_TRUE(bitmap.ToVector() == values);
+  ASSERT_LT(bitmap.MemoryUsage(), before);
+  for (uint32_t value : {uint32_t(0), values[100], values[20000], values.back()}) {
+    ASSERT_EQ(std::binary_search(values.begin(), values.end(), value), bitmap.Contains(value));
+  }
+  // Adding to a run container.
+  bitmap.Add(values.back() - 1);
+  ASSERT_TRUE(bitmap.Contains(values.back() - 1));
+}
+
+TEST(roaring_set_ops) {
+  RoaringBitmap a = RoaringBitmap::FromValues(MixedValues(1));
+  RoaringBitmap b = RoaringBitmap::FromValues(MixedValues(2));
+  ASSERT_TRUE(OpsMatch(a, b));
+  ASSERT_TRUE(OpsMatch(b, a));
+  ASSERT_TRUE(OpsMatch(a, RoaringBitmap()));
+  ASSERT_TRUE(OpsMatch(a, a));
+  a.RunOptimize();
+  ASSERT_TRUE(OpsMatch(a, b));
+  ASSERT_TRUE(OpsMatch(b, a));
+  ASSERT_TRUE(RoaringBitmap::Xor(a, a).empty());
+}
+
+TEST(roaring_graph_sets) {
+  auto graph = graph::GraphBuilder<int>::DirectedGraph()
+                   .AddEdge(1, 2).AddEdge(2, 3).AddEdge(3, 1).AddEdge(3, 100000)
+                   .AddEdge(5, 6).Build();
+  const std::unordered_set<int> reachable = graph::Reachable<int>(graph, 2);
+  const RoaringBitmap bitmap = RoaringBitmap::FromSet(reachable);
+  ASSERT_EQ(4, bitmap.Cardinality());
+  ASSERT_TRUE(bitmap.Contains(100000));
+  ASSERT_TRUE(bitmap.ToSet<int>() == reachable);
+}
+
+}  // namespace bitwise
@@ -1,18 +1,12 @@
-
 #include "edit_distance.h"
 
 #include <algorithm>
-#include <unordered_map>
+#include <cstdint>
+#include <limits>
+#include <vector>
 
-// Assumes all strings are null terminated
+// The const char* functions assume null terminated strings.
 namespace strings {
-struct PairHasher {
-  size_t operator() (const std::pair<const char*, const char*>& p) const {
-    return size_t(p.first) + 32503 * size_t(p.second);
-  }
-};
-typedef std::unordered_map<std::pair<const char*, const char*>, int, strings::PairHasher> Matrix;
-
 namespace {
 int Length(const char* str) {
   if (str == nullptr) return 0;
@@ -23,34 +17,54 @@ int Length(const char* str) {
   return str - begin;
 }
 
-// Always returns the remaining cost
-int InternalEditDistance(const char* a, const char* b, Matrix* matrix) {
-  std::pair<const char*, const char*> pair = std::make_pair(a, b);
-  auto it = matrix->find(pair);
-  if (it != matrix->end()) {
-    return it->second;
+// Fills the dynamic programming matrix one row per character of `longer`,
+// keeping only the previous row. Cell j of a row is the distance between
+// the prefixes so far and the first j characters of `shorter`. Cell must
+// hold the length of `longer` plus one, which the candidates can reach.
+template <typename Cell>
+int RollingEditDistance(std::string_view longer, std::string_view shorter) {
+  std::vector<Cell> previous(shorter.size() + 1);
+  std::vector<Cell> current(shorter.size() + 1);
+  for (size_t j = 0; j <= shorter.size(); ++j) {
+    previous[j] = j;
   }
-  int result = -1;
-  if (b == nullptr || *b == '\0') {
-    result = Length(a);
-  } else if (a == nullptr || *a == '\0') {
-    result = Length(b);
-  } else if (*a == *b) {
-    result = InternalEditDistance(a + 1, b + 1, matrix);
-  } else {
-    const int replace = 1 + InternalEditDistance(a + 1, b + 1, matrix);
-    const int delete_a = 1 + InternalEditDistance(a + 1, b, matrix);
-    const int delete_b = 1 + InternalEditDistance(a, b + 1, matrix);
-    result = std::min(replace, std::min(delete_a, delete_b));
+  for (size_t i = 0; i < longer.size(); ++i) {
+    current[0] = i + 1;
+    const char c = longer[i];
+    for (size_t j = 0; j < shorter.size(); ++j) {
+      const Cell replace = previous[j] + (c != shorter[j]);
+      const Cell delete_longer = previous[j + 1] + 1;
+      const Cell delete_shorter = current[j] + 1;
+      current[j + 1] = std::min(replace, std::min(delete_longer, delete_shorter));
+    }
+    previous.swap(current);
   }
-  matrix->insert(std::make_pair(pair, result));
-  return result;
+  return previous[shorter.size()];
 }
 }  // namespace
 
+int EditDistance(std::string_view a, std::string_view b) {
+  // A common prefix or suffix never costs anything.
+  while (!a.empty() && !b.empty() && a.front() == b.front()) {
+    a.remove_prefix(1);
+    b.remove_prefix(1);
+  }
+  while (!a.empty() && !b.empty() && a.back() == b.back()) {
+    a.remove_suffix(1);
+    b.remove_suffix(1);
+  }
+  if (a.size() < b.size()) std::swap(a, b);
+  if (b.empty()) return a.size();
+  // Half the memory, and twice the cells per vector, when lengths allow.
+  if (a.size() < std::numeric_limits<uint16_t>::max()) {
+    return RollingEditDistance<uint16_t>(a, b);
+  }
+  return RollingEditDistance<int>(a, b);
+}
+
 int EditDistance(const char* a, const char* b) {
-  Matrix matrix;
-  return InternalEditDistance(a, b, &matrix);
+  return EditDistance(std::string_view(a == nullptr ? "" : a, Length(a)),
+                      std::string_view(b == nullptr ? "" : b, Length(b)));
 }
 
 int BruteEditDistance(const char* a, const char* b) {
@@ -1,8 +1,15 @@
 #ifndef EDIT_DISTANCE_H
 #define EDIT_DISTANCE_H
 
+#include <string_view>
+
 namespace strings {
+// Number of single character insertions, deletions and replacements that
+// turn `a` into `b`. Null counts as the empty string.
 int EditDistance(const char* a, const char* b);
+// Same without scanning for the terminating null, which may be inside too.
+// Takes time O(|a| * |b|) but memory only O(min(|a|, |b|)).
+int EditDistance(std::string_view a, std::string_view b);
 int BruteEditDistance(const char* a, const char* b);
 }  // namespace strings
 
@@ -1,6 +1,8 @@
 
 #include "edit_distance.h"
 
+#include <string>
+
 #include "../base/testing.h"
 
 namespace {
@@ -10,6 +12,17 @@ const char kZaa[] = "zaaaaa";
 const char kXaa[] = "xaaaaa";
 const char kXax[] = "xxxaaaaaxx";
 
+// Short strings over a small alphabet, so they share many characters.
+std::string RandomString(uint32_t* seed, size_t max_length) {
+  *seed = *seed * 1103515245 + 12345;
+  std::string result((*seed >> 16) % (max_length + 1), ' ');
+  for (char& c : result) {
+    *seed = *seed * 1103515245 + 12345;
+    c = 'a' + (*seed >> 16) % 3;
+  }
+  return result;
+}
+
 TEST(edit_distance_test) {
   ASSERT_EQ(0, strings::EditDistance(kEmpty, kEmpty));
   ASSERT_EQ(1, strings::EditDistance(kEmpty, "a"));
@@ -28,4 +41,48 @@ const char kShort[] = "hej blah x blah";
 TEST(edit_distance_comparison_test) {
   ASSERT_EQ(strings::BruteEditDistance(kShorter, kShort), strings::EditDistance(kShorter, kShort));
 }
+
+TEST(edit_distance_random_test) {
+  uint32_t seed = 7;
+  for (int i = 0; i < 300; ++i) {
+    const std::string a = RandomString(&seed, 9);
+    const std::string b = RandomString(&seed, 9);
+    ASSERT_EQ(strings::BruteEditDistance(a.c_str(), b.c_str()),
+              strings::EditDistance(a.c_str(), b.c_str()));
+    ASSERT_EQ(strings::EditDistance(a.c_str(), b.c_str()), strings::EditDistance(b, a));
+  }
+  ASSERT_EQ(2, strings::EditDistance(nullptr, "ab"));
+  ASSERT_EQ(2, strings::EditDistance("ab", nullptr));
+}
+
+TEST(edit_distance_string_view_test) {
+  // Null characters are ordinary characters with explicit lengths.
+  const std::string a("a\0b\0c", 5);
+  const std::string b("a\0x\0c", 5);
+  ASSERT_EQ(1, strings::EditDistance(a, b));
+  ASSERT_EQ(5, strings::EditDistance(a, ""));
+}
+
+TEST(edit_distance_long_test) {
+  // Far apart replacements in 10KB records, each costs one.
+  std::string a;
+  for (size_t i = 0; i < 10000; ++i) {
+    a.push_back('a' + i * i % 26);
+  }
+  std::string b = a;
+  for (size_t i = 100; i < b.size(); i += 1000) {
+    b[i] = '#';
+  }
+  b.insert(5000, "+");
+  ASSERT_EQ(11, strings::EditDistance(a, b));
+
+  // Longer than uint16_t cells can count.
+  const std::string many(70000, 'a');
+  ASSERT_EQ(70000, strings::EditDistance(many, "b"));
+  ASSERT_EQ(69999, strings::EditDistance("xa", many));
+  // Around the largest length uint16_t cells are used for.
+  for (int size : {65534, 65535, 65536}) {
+    ASSERT_EQ(size, strings::EditDistance(std::string(size, 'a'), "b"));
+  }
+}
 }  // namespace
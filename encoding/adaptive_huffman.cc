@@ -0,0 +1,98 @@
+#include "adaptive_huffman.h"
+
+#include <algorithm>
+
+#include "huffman_frames.h"
+
+namespace huffman {
+namespace {
+const uint8_t kReuseCode = 0;
+const uint8_t kNewCode = 1;
+// Shortest limit that still has room for all 256 bytes and Escape.
+const int kMinCodeLength = 9;
+}  // namespace
+
+uint64_t EncodedBits(const Huffman& huff, const ByteCounts& counts) {
+  uint64_t bits = 0;
+  for (size_t token = 0; token < counts.size(); ++token) {
+    if (counts[token] > 0) bits += counts[token] * huff.EncodedLength(token);
+  }
+  return bits;
+}
+
+AdaptiveEncoder::AdaptiveEncoder(int max_code_length)
+    : max_code_length_(
+          std::min(std::max(max_code_length, kMinCodeLength), Huffman::kMaxCodeBookLength)) {}
+
+bool AdaptiveEncoder::EncodeBlock(const uint8_t* data, size_t size, std::vector<uint8_t>* out) {
+  if (size > kMaxFrameBlockSize) return false;
+  if (size == 0) return true;
+  const ByteCounts counts = CountBytes(data, size);
+  std::vector<float> distribution;
+  std::vector<unsigned char> tokens;
+  NormalizeCounts(counts, &distribution, &tokens);
+  std::unique_ptr<Huffman> fresh(new Huffman(distribution, tokens, max_code_length_));
+  if (!fresh->is_successful()) return false;
+
+  // The code book pays off if it saves more bits than it takes.
+  const bool write_code_book =
+      code_ == nullptr ||
+      EncodedBits(*fresh, counts) + 8 * Huffman::kCodeBookSize < EncodedBits(*code_, counts);
+  if (write_code_book) {
+    std::vector<uint8_t> code_book;
+    if (!fresh->SerializeCodeBook(&code_book)) return false;
+    out->push_back(kNewCode);
+    out->insert(out->end(), code_book.begin(), code_book.end());
+    code_ = std::move(fresh);
+    ++num_code_books_;
+  } else {
+    out->push_back(kReuseCode);
+  }
+  ++num_blocks_;
+  return EncodeFrames(*code_, data, size, std::max<size_t>(size, 1), 1, out);
+}
+
+bool AdaptiveDecoder::DecodeBlock(const uint8_t* data, size_t size, size_t* consumed,
+                                  std::vector<uint8_t>* out) {
+  if (size == 0) return false;
+  size_t offset = 1;
+  if (data[0] == kNewCode) {
+    if (size - offset < Huffman::kCodeBookSize) return false;
+    code_.reset(new Huffman(data + offset, Huffman::kCodeBookSize));
+    offset += Huffman::kCodeBookSize;
+  } else if (data[0] != kReuseCode) {
+    return false;
+  }
+  if (code_ == nullptr || !code_->is_successful()) return false;
+
+  const size_t frame_size = FrameSize(data + offset, size - offset);
+  if (frame_size == 0 || !DecodeFrames(*code_, data + offset, frame_size, 1, out)) {
+    return false;
+  }
+  *consumed = offset + frame_size;
+  return true;
+}
+
+bool EncodeAdaptive(const uint8_t* data, size_t size, size_t block_size,
+                    std::vector<uint8_t>* out) {
+  if (block_size == 0) return false;
+  AdaptiveEncoder encoder;
+  for (size_t offset = 0; offset < size; offset += block_size) {
+    if (!encoder.EncodeBlock(data + offset, std::min(block_size, size - offset), out)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool DecodeAdaptive(const uint8_t* data, size_t size, std::vector<uint8_t>* out) {
+  AdaptiveDecoder decoder;
+  for (size_t offset = 0; offset < size;) {
+    size_t consumed = 0;
+    if (!decoder.DecodeBlock(data + offset, size - offset, &consumed, out)) return false;
+    offset += consumed;
+  }
+  return true;
+}
+
+}  // namespace huffman
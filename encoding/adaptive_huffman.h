@@ -0,0 +1,82 @@
+// Huffman coding with a fresh code per block, for data whose statistics
+// drift.
+//
+// Each block is counted and gets a length-limited code built from its own
+// histogram. The code book is only written when the bits it saves over
+// reusing the previous code pay for the code book itself, so blocks with
+// similar statistics share one code. Data is read once: each block is
+// counted and then encoded while it is still in cache.
+//
+// Block layout:
+// [1 if a code book follows, else 0][code book, see SerializeCodeBook]
+// [frame, see huffman_frames.h]
+//
+// Example:
+// AdaptiveEncoder encoder;
+// for (each block) encoder.EncodeBlock(data, size, &encoded);
+// AdaptiveDecoder decoder;
+// while (offset < encoded.size()) {
+//   decoder.DecodeBlock(encoded.data() + offset, encoded.size() - offset, &consumed, &decoded);
+//   offset += consumed;
+// }
+
+#ifndef ADAPTIVE_HUFFMAN_H
+#define ADAPTIVE_HUFFMAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "histogram.h"
+#include "huffman.h"
+
+namespace huffman {
+
+const size_t kDefaultAdaptiveBlockSize = 1 << 16;
+
+class AdaptiveEncoder {
+ public:
+  // Codes are at most `max_code_length` bits, which must be between 9 and
+  // Huffman::kMaxCodeBookLength so every block can be coded.
+  explicit AdaptiveEncoder(int max_code_length = Huffman::kMaxCodeBookLength);
+
+  // Appends the `size` bytes at `data` to `out` as one block.
+  // Empty blocks append nothing.
+  // Returns false if `size` is above kMaxFrameBlockSize.
+  bool EncodeBlock(const uint8_t* data, size_t size, std::vector<uint8_t>* out);
+
+  size_t num_blocks() const { return num_blocks_; }
+  size_t num_code_books() const { return num_code_books_; }
+
+ private:
+  const int max_code_length_;
+  std::unique_ptr<Huffman> code_;  // Code of the previous block.
+  size_t num_blocks_ = 0;
+  size_t num_code_books_ = 0;
+};
+
+class AdaptiveDecoder {
+ public:
+  // Decodes the block at the start of `data` and appends it to `out`.
+  // Sets `consumed` to the size of the block. Returns false if the block is
+  // truncated or invalid.
+  bool DecodeBlock(const uint8_t* data, size_t size, size_t* consumed,
+                   std::vector<uint8_t>* out);
+
+ private:
+  std::unique_ptr<Huffman> code_;  // Code of the previous block.
+};
+
+// Encodes `size` bytes in blocks of `block_size`.
+bool EncodeAdaptive(const uint8_t* data, size_t size, size_t block_size,
+                    std::vector<uint8_t>* out);
+// Decodes all blocks of `data`.
+bool DecodeAdaptive(const uint8_t* data, size_t size, std::vector<uint8_t>* out);
+
+// Bits to encode bytes with `counts` using `huff`, padding not included.
+uint64_t EncodedBits(const Huffman& huff, const ByteCounts& counts);
+
+}  // namespace huffman
+
+#endif
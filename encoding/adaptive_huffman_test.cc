@@ -0,0 +1,123 @@
+#include "adaptive_huffman.h"
+
+#include <string>
+#include <vector>
+
+#include "../base/testing.h"
+#include "huffman_frames.h"
+
+namespace huffman {
+namespace {
+// Log-like text, then binary data with a different skew, then text again.
+std::vector<uint8_t> MixedData() {
+  std::vector<uint8_t> result;
+  uint32_t value = 99;
+  auto next = [&value] {
+    value = value * 1103515245 + 12345;
+    return value >> 16;
+  };
+  for (size_t i = 0; i < 200000; ++i) {
+    result.push_back(i % 60 == 59 ? '\n' : "etaoin shrdlu:0123"[next() % 18]);
+  }
+  for (size_t i = 0; i < 200000; ++i) {
+    result.push_back(next() % 4 == 0 ? next() : 0x80 + next() % 8);
+  }
+  for (size_t i = 0; i < 200000; ++i) {
+    result.push_back(i % 60 == 59 ? '\n' : "etaoin shrdlu:0123"[next() % 18]);
+  }
+  return result;
+}
+}  // namespace
+
+TEST(adaptive_round_trip) {
+  const std::vector<uint8_t> data = MixedData();
+  for (size_t block_size : {size_t(1), size_t(1000), kDefaultAdaptiveBlockSize, size_t(1 << 20)}) {
+    const size_t size = block_size == 1 ? 5000 : data.size();
+    std::vector<uint8_t> encoded;
+    ASSERT_TRUE(EncodeAdaptive(data.data(), size, block_size, &encoded));
+    std::vector<uint8_t> decoded;
+    ASSERT_TRUE(DecodeAdaptive(encoded.data(), encoded.size(), &decoded));
+    ASSERT_TRUE(decoded == std::vector<uint8_t>(data.begin(), data.begin() + size));
+  }
+
+  std::vector<uint8_t> encoded;
+  ASSERT_TRUE(EncodeAdaptive(data.data(), 0, 1000, &encoded));
+  ASSERT_EMPTY(encoded);
+  ASSERT_FALSE(EncodeAdaptive(data.data(), 10, 0, &encoded));
+}
+
+TEST(adaptive_code_books_only_when_worth_it) {
+  const std::vector<uint8_t> data = MixedData();
+  AdaptiveEncoder encoder;
+  std::vector<uint8_t> encoded;
+  for (size_t offset = 0; offset < data.size(); offset += kDefaultAdaptiveBlockSize) {
+    const size_t size = std::min(kDefaultAdaptiveBlockSize, data.size() - offset);
+    ASSERT_TRUE(encoder.EncodeBlock(data.data() + offset, size, &encoded));
+  }
+  ASSERT_EQ(10, encoder.num_blocks());
+  // One for each change of statistics, where blocks straddling a change may
+  // need one more.
+  ASSERT_GE(encoder.num_code_books(), 3);
+  ASSERT_LE(encoder.num_code_books(), 5);
+
+  // Identical blocks share the first code book.
+  AdaptiveEncoder same;
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(same.EncodeBlock(data.data(), 10000, &encoded));
+  }
+  ASSERT_EQ(1, same.num_code_books());
+}
+
+TEST(adaptive_beats_static_code) {
+  const std::vector<uint8_t> data = MixedData();
+  std::vector<uint8_t> adaptive;
+  ASSERT_TRUE(EncodeAdaptive(data.data(), data.size(), kDefaultAdaptiveBlockSize, &adaptive));
+
+  // A static code trained on the first block escapes the binary part.
+  std::vector<float> distribution;
+  std::vector<unsigned char> tokens;
+  NormalizeCounts(CountBytes(data.data(), kDefaultAdaptiveBlockSize), &distribution, &tokens);
+  const Huffman first_block(distribution, tokens);
+  std::vector<uint8_t> first_block_frames;
+  EncodeFrames(first_block, data.data(), data.size(), kDefaultAdaptiveBlockSize, 1,
+               &first_block_frames);
+  // Even one trained on all of it does worse than a code per block.
+  NormalizeCounts(CountBytes(data.data(), data.size()), &distribution, &tokens);
+  const Huffman whole(distribution, tokens);
+  std::vector<uint8_t> whole_frames;
+  EncodeFrames(whole, data.data(), data.size(), kDefaultAdaptiveBlockSize, 1, &whole_frames);
+
+  LOG(INFO) << data.size() << " bytes, adaptive " << adaptive.size() << ", first block code "
+            << first_block_frames.size() << ", whole input code " << whole_frames.size();
+  ASSERT_LT(adaptive.size(), whole_frames.size());
+  ASSERT_LT(whole_frames.size(), first_block_frames.size());
+}
+
+TEST(adaptive_invalid) {
+  const std::vector<uint8_t> data = MixedData();
+  std::vector<uint8_t> encoded;
+  ASSERT_TRUE(EncodeAdaptive(data.data(), 3000, 1000, &encoded));
+  std::vector<uint8_t> decoded;
+  ASSERT_FALSE(DecodeAdaptive(encoded.data(), encoded.size() - 1, &decoded));
+
+  // Reusing a code before any code book.
+  std::vector<uint8_t> no_code = encoded;
+  no_code[0] = 0;
+  ASSERT_FALSE(DecodeAdaptive(no_code.data(), no_code.size(), &decoded));
+  no_code[0] = 7;
+  ASSERT_FALSE(DecodeAdaptive(no_code.data(), no_code.size(), &decoded));
+}
+
+TEST(encoded_bits) {
+  const Huffman huff({0.5, 0.25}, "ab");
+  ByteCounts counts{};
+  counts['a'] = 10;
+  counts['b'] = 3;
+  counts['z'] = 2;
+  const uint64_t expected = 10 * huff.Code('a').size() + 3 * huff.Code('b').size() +
+                            2 * huff.Encoded('z').size();
+  ASSERT_EQ(expected, EncodedBits(huff, counts));
+  ASSERT_EQ(huff.Encoded('z').size(), size_t(huff.EncodedLength('z')));
+}
+
+}  // namespace huffman
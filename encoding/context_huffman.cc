@@ -0,0 +1,280 @@
+#include "context_huffman.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "../bitwise/bitstream.h"
+#include "histogram.h"
+#include "huffman.h"
+
+using bitstream::BitInStreamer;
+using bitstream::BitOutStreamer;
+
+namespace huffman {
+namespace {
+const int kCodeBits = Huffman::kDecodeTableBits;
+const size_t kDecodeTableSize = size_t(1) << kCodeBits;
+const uint16_t kEscapeFlag = 1 << 12;
+// Rounds of reassigning contexts to clusters.
+const int kClusterRounds = 10;
+
+using Histogram = std::array<uint64_t, 256>;
+
+// Bits to code each byte with a code fit to `histogram`, in a smoothed
+// estimate so bytes the cluster has not seen yet are not free.
+std::array<double, 256> SymbolCosts(const Histogram& histogram) {
+  const double kPrior = 0.5;
+  double total = 256 * kPrior;
+  for (uint64_t count : histogram) {
+    total += count;
+  }
+  std::array<double, 256> costs;
+  for (size_t symbol = 0; symbol < 256; ++symbol) {
+    costs[symbol] = std::log2(total / (histogram[symbol] + kPrior));
+  }
+  return costs;
+}
+
+double Cost(const Histogram& histogram, const std::array<double, 256>& costs) {
+  double bits = 0.0;
+  for (size_t symbol = 0; symbol < 256; ++symbol) {
+    bits += histogram[symbol] * costs[symbol];
+  }
+  return bits;
+}
+
+// Groups the contexts with any counts into at most `max_clusters` clusters
+// of similar statistics, like k-means with coding cost as distance. Seeds
+// are picked farthest first, starting with the most common context.
+// Contexts without counts join the largest cluster. Returns the number of
+// clusters.
+size_t ClusterContexts(const std::vector<Histogram>& contexts, size_t max_clusters,
+                       std::array<uint8_t, 256>* context_map) {
+  std::vector<size_t> totals(256, 0);
+  std::vector<size_t> used;
+  for (size_t context = 0; context < 256; ++context) {
+    for (uint64_t count : contexts[context]) {
+      totals[context] += count;
+    }
+    if (totals[context] > 0) used.push_back(context);
+  }
+  context_map->fill(0);
+  if (used.empty()) return 1;
+
+  std::vector<std::array<double, 256>> context_costs;
+  for (size_t context : used) {
+    context_costs.push_back(SymbolCosts(contexts[context]));
+  }
+  // Seeds: each next one is the context coded worst by the closest seed.
+  std::vector<size_t> seeds = {*std::max_element(
+      used.begin(), used.end(), [&totals](size_t a, size_t b) { return totals[a] < totals[b]; })};
+  std::vector<double> best_cost(used.size(), 1e300);
+  while (seeds.size() < std::min(max_clusters, used.size())) {
+    const std::array<double, 256> seed_costs = SymbolCosts(contexts[seeds.back()]);
+    size_t farthest = 0;
+    for (size_t i = 0; i < used.size(); ++i) {
+      // Extra bits over the context's own code.
+      const double extra = Cost(contexts[used[i]], seed_costs) -
+                           Cost(contexts[used[i]], context_costs[i]);
+      best_cost[i] = std::min(best_cost[i], extra);
+      if (best_cost[i] > best_cost[farthest]) farthest = i;
+    }
+    if (best_cost[farthest] <= 0.0) break;
+    seeds.push_back(used[farthest]);
+  }
+
+  std::vector<Histogram> clusters;
+  for (size_t seed : seeds) {
+    clusters.push_back(contexts[seed]);
+  }
+  std::vector<size_t> assignment(used.size(), clusters.size());
+  for (int round = 0; round < kClusterRounds; ++round) {
+    std::vector<std::array<double, 256>> cluster_costs;
+    for (const Histogram& cluster : clusters) {
+      cluster_costs.push_back(SymbolCosts(cluster));
+    }
+    bool changed = false;
+    for (size_t i = 0; i < used.size(); ++i) {
+      size_t best = 0;
+      double best_bits = 1e300;
+      for (size_t c = 0; c < clusters.size(); ++c) {
+        const double bits = Cost(contexts[used[i]], cluster_costs[c]);
+        if (bits < best_bits) {
+          best_bits = bits;
+          best = c;
+        }
+      }
+      changed |= assignment[i] != best;
+      assignment[i] = best;
+    }
+    if (!changed) break;
+    for (Histogram& cluster : clusters) {
+      cluster.fill(0);
+    }
+    for (size_t i = 0; i < used.size(); ++i) {
+      AddCounts(contexts[used[i]], &clusters[assignment[i]]);
+    }
+  }
+
+  // Drops clusters nobody joined, and puts unused contexts in the largest.
+  std::vector<size_t> cluster_sizes(clusters.size(), 0);
+  for (size_t i = 0; i < used.size(); ++i) {
+    cluster_sizes[assignment[i]] += totals[used[i]];
+  }
+  std::vector<size_t> renumbered(clusters.size(), 0);
+  size_t num_clusters = 0;
+  for (size_t c = 0; c < clusters.size(); ++c) {
+    if (cluster_sizes[c] > 0) renumbered[c] = num_clusters++;
+  }
+  const size_t largest =
+      std::max_element(cluster_sizes.begin(), cluster_sizes.end()) - cluster_sizes.begin();
+  context_map->fill(renumbered[largest]);
+  for (size_t i = 0; i < used.size(); ++i) {
+    (*context_map)[used[i]] = renumbered[assignment[i]];
+  }
+  return num_clusters;
+}
+
+// Right aligned bits of a string of 0 and 1.
+uint32_t CodeBits(const std::string& code) {
+  uint32_t bits = 0;
+  for (char bit : code) {
+    bits = (bits << 1) | (bit == '1');
+  }
+  return bits;
+}
+}  // namespace
+
+ContextHuffman::ContextHuffman(const uint8_t* sample, size_t size, size_t max_clusters) {
+  max_clusters = std::min<size_t>(std::max<size_t>(max_clusters, 1), 255);
+  std::vector<Histogram> contexts(256, Histogram{});
+  uint8_t previous = 0;
+  for (size_t i = 0; i < size; ++i) {
+    ++contexts[previous][sample[i]];
+    previous = sample[i];
+  }
+  num_clusters_ = ClusterContexts(contexts, max_clusters, &context_map_);
+
+  std::vector<ByteCounts> cluster_counts(num_clusters_, ByteCounts{});
+  for (size_t context = 0; context < 256; ++context) {
+    AddCounts(contexts[context], &cluster_counts[context_map_[context]]);
+  }
+  std::vector<std::vector<uint8_t>> code_books(num_clusters_);
+  for (size_t c = 0; c < num_clusters_; ++c) {
+    std::vector<float> distribution;
+    std::vector<unsigned char> tokens;
+    NormalizeCounts(cluster_counts[c], &distribution, &tokens);
+    const Huffman huff(distribution, tokens, kCodeBits);
+    if (!huff.SerializeCodeBook(&code_books[c])) return;
+  }
+  successful_ = BuildTables(code_books);
+}
+
+ContextHuffman ContextHuffman::Load(const uint8_t* serialized, size_t size) {
+  ContextHuffman model;
+  if (size < 1 + 256) return model;
+  model.num_clusters_ = serialized[0];
+  if (model.num_clusters_ == 0 || size != 1 + 256 + model.num_clusters_ * Huffman::kCodeBookSize) {
+    return model;
+  }
+  std::copy(serialized + 1, serialized + 1 + 256, model.context_map_.begin());
+  for (uint8_t cluster : model.context_map_) {
+    if (cluster >= model.num_clusters_) return model;
+  }
+  std::vector<std::vector<uint8_t>> code_books;
+  const uint8_t* code_book = serialized + 1 + 256;
+  for (size_t c = 0; c < model.num_clusters_; ++c) {
+    code_books.emplace_back(code_book, code_book + Huffman::kCodeBookSize);
+    code_book += Huffman::kCodeBookSize;
+  }
+  model.successful_ = model.BuildTables(code_books);
+  return model;
+}
+
+bool ContextHuffman::BuildTables(const std::vector<std::vector<uint8_t>>& code_books) {
+  encode_table_.assign(num_clusters_ * 256, 0);
+  decode_table_.assign(num_clusters_ * kDecodeTableSize, 0);
+  for (size_t c = 0; c < num_clusters_; ++c) {
+    const Huffman huff(code_books[c].data(), code_books[c].size());
+    if (!huff.is_successful()) return false;
+    const std::string escape = huff.EscapeCode();
+    if (escape.size() > size_t(kCodeBits)) return false;
+
+    uint16_t* decode = &decode_table_[c * kDecodeTableSize];
+    auto fill_decode = [decode](const std::string& code, uint16_t value) {
+      const int unused_bits = kCodeBits - code.size();
+      const size_t first = size_t(CodeBits(code)) << unused_bits;
+      std::fill(decode + first, decode + first + (size_t(1) << unused_bits),
+                value | (code.size() << 8));
+    };
+    fill_decode(escape, kEscapeFlag);
+    for (size_t token = 0; token < 256; ++token) {
+      const std::string code = huff.Encoded(token);
+      if (code.size() > size_t(kCodeBits) + 8) return false;
+      encode_table_[c * 256 + token] = (CodeBits(code) << 5) | code.size();
+      // Unknown bytes decode through the Escape entry.
+      if (code != huff.Code(token)) continue;
+      fill_decode(code, token);
+    }
+  }
+  code_books_ = code_books;
+  return true;
+}
+
+void ContextHuffman::Serialize(std::vector<uint8_t>* out) const {
+  out->push_back(num_clusters_);
+  out->insert(out->end(), context_map_.begin(), context_map_.end());
+  for (const std::vector<uint8_t>& code_book : code_books_) {
+    out->insert(out->end(), code_book.begin(), code_book.end());
+  }
+}
+
+void ContextHuffman::Encode(const uint8_t* data, size_t size, std::vector<uint8_t>* out) const {
+  bitstream::VectorSink sink(out);
+  BitOutStreamer bits(&sink);
+  const uint32_t* table = encode_table_.data();
+  uint64_t pending = 0;
+  int num_pending = 0;
+  uint8_t previous = 0;
+  for (size_t i = 0; i < size; ++i) {
+    const uint32_t entry = table[context_map_[previous] * 256 + data[i]];
+    const int length = entry & 0x1F;
+    if (num_pending + length > 64) {
+      bits.PushBits(pending, num_pending);
+      pending = 0;
+      num_pending = 0;
+    }
+    pending = (pending << length) | (entry >> 5);
+    num_pending += length;
+    previous = data[i];
+  }
+  bits.PushBits(pending, num_pending);
+  bits.FlushRemaining();
+}
+
+bool ContextHuffman::Decode(const uint8_t* data, size_t size, size_t num_tokens,
+                            uint8_t* output) const {
+  if (!successful_) return false;
+  BitInStreamer in(data, size);
+  const uint16_t* tables[256];
+  for (size_t context = 0; context < 256; ++context) {
+    tables[context] = &decode_table_[context_map_[context] * kDecodeTableSize];
+  }
+  uint8_t previous = 0;
+  for (size_t i = 0; i < num_tokens; ++i) {
+    const uint16_t entry = tables[previous][in.PeekBits(kCodeBits)];
+    in.ConsumeBits((entry >> 8) & 0xF);
+    // Escape code is followed by the original byte.
+    previous = entry & kEscapeFlag ? in.ReadBits(8) : entry & 0xFF;
+    output[i] = previous;
+  }
+  return !in.overrun();
+}
+
+size_t ContextHuffman::TableMemoryUsage() const {
+  return encode_table_.size() * sizeof(encode_table_[0]) +
+         decode_table_.size() * sizeof(decode_table_[0]) + sizeof(context_map_);
+}
+
+}  // namespace huffman
@@ -0,0 +1,79 @@
+// Order-1 Huffman coding: each byte is coded with a code chosen by the byte
+// before it.
+//
+// A code per previous byte would take 256 tables, so contexts with similar
+// statistics are clustered and share a code. Codes are limited to
+// Huffman::kDecodeTableBits bits, so every cluster decodes with one lookup
+// into a table of 2^11 entries of 2 bytes. With the default 16 clusters all
+// encoding and decoding tables take about 80KB, well within L2.
+//
+// Serialized layout:
+// [number of clusters][cluster of each previous byte, 256 bytes]
+// [code book of each cluster, see Huffman::SerializeCodeBook]
+//
+// Example:
+// ContextHuffman model(sample, sample_size);
+// std::vector<uint8_t> encoded;
+// model.Encode(data, size, &encoded);
+// model.Decode(encoded.data(), encoded.size(), size, output);
+
+#ifndef CONTEXT_HUFFMAN_H
+#define CONTEXT_HUFFMAN_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace huffman {
+
+const size_t kDefaultContextClusters = 16;
+
+class ContextHuffman {
+ public:
+  // Trains on the `size` bytes at `sample`, with at most `max_clusters`
+  // codes, between 1 and 255.
+  ContextHuffman(const uint8_t* sample, size_t size,
+                 size_t max_clusters = kDefaultContextClusters);
+  // Loads a model written by Serialize. Not successful if it is invalid.
+  static ContextHuffman Load(const uint8_t* serialized, size_t size);
+
+  bool is_successful() const { return successful_; }
+  size_t num_clusters() const { return num_clusters_; }
+  // Cluster of the code used after `previous`.
+  size_t cluster(uint8_t previous) const { return context_map_[previous]; }
+
+  void Serialize(std::vector<uint8_t>* out) const;
+
+  // Appends the codes of the `size` bytes at `data` to `out`, padded to a
+  // byte. The first byte is coded as if it followed a zero byte.
+  void Encode(const uint8_t* data, size_t size, std::vector<uint8_t>* out) const;
+  // Decodes `num_tokens` bytes from the output of Encode.
+  // Returns false if the input ends before that.
+  bool Decode(const uint8_t* data, size_t size, size_t num_tokens, uint8_t* output) const;
+
+  // Bytes used by the encoding and decoding tables.
+  size_t TableMemoryUsage() const;
+
+ private:
+  ContextHuffman() = default;
+
+  // Builds the tables from one serialized code book per cluster.
+  bool BuildTables(const std::vector<std::vector<uint8_t>>& code_books);
+
+  bool successful_ = false;
+  size_t num_clusters_ = 0;
+  std::array<uint8_t, 256> context_map_{};
+  std::vector<std::vector<uint8_t>> code_books_;
+
+  // Per cluster and byte: the code bits, Escape code and byte for unknown
+  // bytes, shifted left by 5, plus the code length.
+  std::vector<uint32_t> encode_table_;
+  // Per cluster and next kDecodeTableBits bits: the byte, plus its code
+  // length times 256, plus kEscapeFlag for the Escape code.
+  std::vector<uint16_t> decode_table_;
+};
+
+}  // namespace huffman
+
+#endif
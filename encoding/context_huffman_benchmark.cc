@@ -0,0 +1,111 @@
+#include "context_huffman.h"
+
+#include <string>
+#include <vector>
+
+#include "../base/benchmark.h"
+#include "../bitwise/bitstream.h"
+#include "histogram.h"
+#include "huffman.h"
+
+namespace huffman {
+namespace {
+const size_t kTextSize = 1 << 20;
+
+// Words from a vocabulary of a few hundred, where the previous letter tells
+// a lot about the next one.
+const std::vector<uint8_t>& Text() {
+  static const std::vector<uint8_t>* text = [] {
+    std::vector<std::string> words;
+    uint32_t value = 12345;
+    auto next = [&value] {
+      value = value * 1103515245 + 12345;
+      return value >> 16;
+    };
+    const std::string kSyllables[] = {"th", "er", "on", "an", "re", "he", "in", "ed",
+                                      "nd", "ha", "at", "en", "es", "of", "or", "nt"};
+    for (size_t i = 0; i < 300; ++i) {
+      std::string word;
+      for (size_t length = 1 + next() % 4; length > 0; --length) {
+        word += kSyllables[next() % 16];
+      }
+      words.push_back(word + (i % 10 == 0 ? ".\n" : " "));
+    }
+    std::vector<uint8_t>* result = new std::vector<uint8_t>();
+    while (result->size() < kTextSize) {
+      // Skewed towards the first words, like a real vocabulary.
+      const std::string& word = words[(next() % 300) * (next() % 300) / 300];
+      result->insert(result->end(), word.begin(), word.end());
+    }
+    result->resize(kTextSize);
+    return result;
+  }();
+  return *text;
+}
+
+const ContextHuffman& Model() {
+  static const ContextHuffman* model = new ContextHuffman(Text().data(), Text().size());
+  return *model;
+}
+
+const Huffman& Order0() {
+  static const Huffman* huffman = [] {
+    std::vector<float> distribution;
+    std::vector<unsigned char> tokens;
+    NormalizeCounts(CountBytes(Text().data(), Text().size()), &distribution, &tokens);
+    return new Huffman(distribution, tokens, Huffman::kDecodeTableBits);
+  }();
+  return *huffman;
+}
+
+const std::vector<uint8_t>& ContextEncoded() {
+  static const std::vector<uint8_t>* encoded = [] {
+    std::vector<uint8_t>* result = new std::vector<uint8_t>();
+    Model().Encode(Text().data(), Text().size(), result);
+    return result;
+  }();
+  return *encoded;
+}
+
+const std::vector<uint8_t>& Order0Encoded() {
+  static const std::vector<uint8_t>* encoded = [] {
+    std::vector<uint8_t>* result = new std::vector<uint8_t>();
+    bitstream::VectorSink sink(result);
+    bitstream::BitOutStreamer out(&sink);
+    Order0().EncodeTokens(Text().data(), Text().size(), &out);
+    out.FlushRemaining();
+    return result;
+  }();
+  return *encoded;
+}
+
+std::vector<uint8_t> output(kTextSize);
+}  // namespace
+
+BENCHMARK(context_huffman_train) {
+  ContextHuffman model(Text().data(), Text().size());
+  benchmark::DoNotOptimize(&model);
+  SetBytesProcessed(Text().size());
+}
+
+BENCHMARK(context_huffman_encode) {
+  static std::vector<uint8_t> encoded;
+  encoded.clear();
+  Model().Encode(Text().data(), Text().size(), &encoded);
+  SetBytesProcessed(Text().size());
+}
+
+BENCHMARK(context_huffman_decode) {
+  Model().Decode(ContextEncoded().data(), ContextEncoded().size(), output.size(), output.data());
+  benchmark::DoNotOptimize(output.data());
+  SetBytesProcessed(Text().size());
+}
+
+// Same text with one code for all bytes, for comparison.
+BENCHMARK(order_0_huffman_decode) {
+  Order0().Decode(Order0Encoded().data(), Order0Encoded().size(), output.size(), output.data());
+  benchmark::DoNotOptimize(output.data());
+  SetBytesProcessed(Text().size());
+}
+
+}  // namespace huffman
@@ -0,0 +1,125 @@
+#include "context_huffman.h"
+
+#include <string>
+#include <vector>
+
+#include "../base/testing.h"
+#include "histogram.h"
+#include "huffman.h"
+
+namespace huffman {
+namespace {
+// Words from a small vocabulary, so the next letter depends on the last.
+std::vector<uint8_t> WordText(size_t size, uint32_t seed) {
+  const char* const kWords[] = {"the ", "quick ", "brown ", "fox ", "jumps ", "over ",
+                                "lazy ", "dog ", "and ", "runs ", "away.\n", "zebra "};
+  std::vector<uint8_t> result;
+  while (result.size() < size) {
+    seed = seed * 1103515245 + 12345;
+    const std::string word = kWords[(seed >> 16) % 12];
+    result.insert(result.end(), word.begin(), word.end());
+  }
+  result.resize(size);
+  return result;
+}
+
+bool RoundTrips(const ContextHuffman& model, const std::vector<uint8_t>& data) {
+  std::vector<uint8_t> encoded;
+  model.Encode(data.data(), data.size(), &encoded);
+  std::vector<uint8_t> decoded(data.size());
+  return model.Decode(encoded.data(), encoded.size(), decoded.size(), decoded.data()) &&
+         decoded == data;
+}
+}  // namespace
+
+TEST(context_huffman_round_trip) {
+  const std::vector<uint8_t> data = WordText(100000, 1);
+  const ContextHuffman model(data.data(), data.size());
+  ASSERT_TRUE(model.is_successful());
+  ASSERT_TRUE(RoundTrips(model, data));
+  ASSERT_TRUE(RoundTrips(model, {}));
+  ASSERT_TRUE(RoundTrips(model, WordText(777, 2)));
+}
+
+TEST(context_huffman_beats_order_0) {
+  const std::vector<uint8_t> data = WordText(100000, 3);
+  const ContextHuffman model(data.data(), data.size());
+  std::vector<uint8_t> context_encoded;
+  model.Encode(data.data(), data.size(), &context_encoded);
+
+  std::vector<float> distribution;
+  std::vector<unsigned char> tokens;
+  NormalizeCounts(CountBytes(data.data(), data.size()), &distribution, &tokens);
+  const Huffman huff(distribution, tokens);
+  const double order_0_bytes = huff.AverageCodeLength(distribution) * data.size() / 8;
+  // Most letters of a word follow from the letter before.
+  ASSERT_TRUE(context_encoded.size() < order_0_bytes / 2);
+}
+
+TEST(context_huffman_clusters) {
+  const std::vector<uint8_t> data = WordText(100000, 4);
+  for (size_t max_clusters : {size_t(1), size_t(4), kDefaultContextClusters, size_t(255)}) {
+    const ContextHuffman model(data.data(), data.size(), max_clusters);
+    ASSERT_TRUE(model.is_successful());
+    ASSERT_TRUE(model.num_clusters() >= 1);
+    ASSERT_TRUE(model.num_clusters() <= max_clusters);
+    ASSERT_TRUE(RoundTrips(model, data));
+  }
+  const ContextHuffman model(data.data(), data.size(), 1);
+  ASSERT_EQ(0u, model.cluster('q'));
+  // Encoding table, decoding table and context map.
+  ASSERT_EQ(256 * 4 + (1 << Huffman::kDecodeTableBits) * 2 + 256, model.TableMemoryUsage());
+}
+
+TEST(context_huffman_unknown_bytes) {
+  const std::vector<uint8_t> data = WordText(10000, 5);
+  const ContextHuffman model(data.data(), data.size(), 3);
+  std::vector<uint8_t> other;
+  for (size_t i = 0; i < 1000; ++i) {
+    other.push_back(i * 7);
+  }
+  ASSERT_TRUE(RoundTrips(model, other));
+
+  const ContextHuffman empty(nullptr, 0);
+  ASSERT_TRUE(empty.is_successful());
+  ASSERT_TRUE(RoundTrips(empty, other));
+}
+
+TEST(context_huffman_serialize) {
+  const std::vector<uint8_t> data = WordText(50000, 6);
+  const ContextHuffman model(data.data(), data.size());
+  std::vector<uint8_t> serialized;
+  model.Serialize(&serialized);
+  ASSERT_EQ(1 + 256 + model.num_clusters() * Huffman::kCodeBookSize, serialized.size());
+
+  const ContextHuffman loaded = ContextHuffman::Load(serialized.data(), serialized.size());
+  ASSERT_TRUE(loaded.is_successful());
+  ASSERT_EQ(model.num_clusters(), loaded.num_clusters());
+  std::vector<uint8_t> encoded;
+  model.Encode(data.data(), data.size(), &encoded);
+  std::vector<uint8_t> decoded(data.size());
+  ASSERT_TRUE(loaded.Decode(encoded.data(), encoded.size(), decoded.size(), decoded.data()));
+  ASSERT_TRUE(decoded == data);
+}
+
+TEST(context_huffman_invalid) {
+  const std::vector<uint8_t> data = WordText(50000, 7);
+  const ContextHuffman model(data.data(), data.size());
+  std::vector<uint8_t> serialized;
+  model.Serialize(&serialized);
+
+  ASSERT_FALSE(ContextHuffman::Load(serialized.data(), serialized.size() - 1).is_successful());
+  std::vector<uint8_t> bad_map = serialized;
+  bad_map[1 + 'e'] = model.num_clusters();
+  ASSERT_FALSE(ContextHuffman::Load(bad_map.data(), bad_map.size()).is_successful());
+  std::vector<uint8_t> bad_book = serialized;
+  bad_book[1 + 256] = 0x11;
+  ASSERT_FALSE(ContextHuffman::Load(bad_book.data(), bad_book.size()).is_successful());
+
+  std::vector<uint8_t> encoded;
+  model.Encode(data.data(), data.size(), &encoded);
+  std::vector<uint8_t> decoded(data.size());
+  ASSERT_FALSE(model.Decode(encoded.data(), encoded.size() / 2, decoded.size(), decoded.data()));
+}
+
+}  // namespace huffman
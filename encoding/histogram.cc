@@ -0,0 +1,108 @@
+#include "histogram.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace huffman {
+namespace {
+// Each 32-bit counter sees at most a quarter of a block, so cannot overflow.
+const size_t kBlockSize = 1 << 30;
+
+// Counts one block into four tables, one per byte lane of each 32-bit word.
+void CountBlock(const uint8_t* data, size_t size, ByteCounts* counts) {
+  uint32_t tables[4][256] = {};
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    uint64_t words[2];
+    std::memcpy(words, data + i, sizeof(words));
+    for (uint64_t word : words) {
+      ++tables[0][word & 0xFF];
+      ++tables[1][(word >> 8) & 0xFF];
+      ++tables[2][(word >> 16) & 0xFF];
+      ++tables[3][(word >> 24) & 0xFF];
+      ++tables[0][(word >> 32) & 0xFF];
+      ++tables[1][(word >> 40) & 0xFF];
+      ++tables[2][(word >> 48) & 0xFF];
+      ++tables[3][word >> 56];
+    }
+  }
+  for (; i < size; ++i) {
+    ++tables[0][data[i]];
+  }
+  for (int value = 0; value < 256; ++value) {
+    (*counts)[value] += uint64_t(tables[0][value]) + tables[1][value] + tables[2][value] +
+                        tables[3][value];
+  }
+}
+
+void CountRange(const uint8_t* data, size_t size, ByteCounts* counts) {
+  for (size_t offset = 0; offset < size; offset += kBlockSize) {
+    CountBlock(data + offset, std::min(kBlockSize, size - offset), counts);
+  }
+}
+}  // namespace
+
+ByteCounts CountBytes(const uint8_t* data, size_t size, size_t num_threads) {
+  num_threads = std::max<size_t>(1, std::min(num_threads, size / kMinBytesPerThread));
+  std::vector<ByteCounts> partial(num_threads);
+  for (ByteCounts& counts : partial) {
+    counts.fill(0);
+  }
+
+  const size_t part_size = size / num_threads;
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < num_threads; ++t) {
+    const size_t begin = t * part_size;
+    const size_t end = t + 1 == num_threads ? size : begin + part_size;
+    threads.emplace_back(CountRange, data + begin, end - begin, &partial[t]);
+  }
+  // The calling thread counts the first part.
+  CountRange(data, std::min(part_size, size), &partial[0]);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  for (size_t t = 1; t < num_threads; ++t) {
+    AddCounts(partial[t], &partial[0]);
+  }
+  return partial[0];
+}
+
+ByteCounts CountBytes(std::istream* input, size_t num_threads) {
+  ByteCounts total;
+  total.fill(0);
+  std::vector<char> buffer(kCountChunkSize);
+  while (*input) {
+    input->read(buffer.data(), buffer.size());
+    const size_t size = input->gcount();
+    if (size == 0) break;
+    AddCounts(CountBytes(reinterpret_cast<const uint8_t*>(buffer.data()), size, num_threads),
+              &total);
+  }
+  return total;
+}
+
+void AddCounts(const ByteCounts& counts, ByteCounts* total) {
+  for (size_t value = 0; value < counts.size(); ++value) {
+    (*total)[value] += counts[value];
+  }
+}
+
+void NormalizeCounts(const ByteCounts& counts, std::vector<float>* distribution,
+                     std::vector<unsigned char>* tokens, uint64_t min_count) {
+  distribution->clear();
+  tokens->clear();
+  min_count = std::max<uint64_t>(min_count, 1);
+  uint64_t total = 0;
+  for (uint64_t count : counts) {
+    total += count;
+  }
+  for (size_t value = 0; value < counts.size(); ++value) {
+    if (counts[value] < min_count) continue;
+    distribution->push_back(double(counts[value]) / total);
+    tokens->push_back(value);
+  }
+}
+
+}  // namespace huffman
@@ -0,0 +1,55 @@
+// Byte histograms of text samples, to train Huffman codes on.
+//
+// Counting one byte at a time stalls on store forwarding whenever the same
+// byte repeats: each increment must wait for the previous store to the same
+// counter. So bytes are counted in four interleaved tables, one per byte
+// lane, which are summed at the end. Large buffers are also split across
+// threads, each with tables of its own.
+//
+// Example:
+// ByteCounts counts = CountBytes(data, size, 4);
+// std::vector<float> distribution;
+// std::vector<unsigned char> tokens;
+// NormalizeCounts(counts, &distribution, &tokens);
+// Huffman huff(distribution, tokens);
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace huffman {
+
+// Number of times each byte occurs.
+using ByteCounts = std::array<uint64_t, 256>;
+
+// Counts the `size` bytes at `data` with up to `num_threads` threads.
+// Inputs shorter than kMinBytesPerThread per thread use fewer threads.
+ByteCounts CountBytes(const uint8_t* data, size_t size, size_t num_threads = 1);
+
+// Counts all bytes left in `input`, reading kCountChunkSize bytes at a time
+// and counting each chunk like CountBytes.
+ByteCounts CountBytes(std::istream* input, size_t num_threads = 1);
+
+// Adds `counts` to `total`, so samples can be counted piece by piece.
+void AddCounts(const ByteCounts& counts, ByteCounts* total);
+
+// Sets `distribution` and `tokens` to the bytes that occur at least
+// `min_count` times and their share of all bytes counted, ready to construct
+// a Huffman code. Rarer bytes are left to the Escape code. Both are empty if
+// no byte is common enough.
+void NormalizeCounts(const ByteCounts& counts, std::vector<float>* distribution,
+                     std::vector<unsigned char>* tokens, uint64_t min_count = 1);
+
+// Less than this per thread is not worth starting a thread for.
+const size_t kMinBytesPerThread = 1 << 20;
+// Bytes read from a stream at a time.
+const size_t kCountChunkSize = 1 << 24;
+
+}  // namespace huffman
+
+#endif
@@ -0,0 +1,50 @@
+#include "histogram.h"
+
+#include <vector>
+
+#include "../base/benchmark.h"
+
+namespace huffman {
+namespace {
+const size_t kSampleSize = 1 << 24;
+
+// Mostly text, with long runs where a single table stalls the most.
+const std::vector<uint8_t>& Sample() {
+  static const std::vector<uint8_t>* sample = [] {
+    std::vector<uint8_t>* result = new std::vector<uint8_t>();
+    uint32_t value = 12345;
+    for (size_t i = 0; i < kSampleSize; ++i) {
+      value = value * 1103515245 + 12345;
+      result->push_back(i % 4096 < 1024 ? ' ' : 'a' + (value >> 16) % 26);
+    }
+    return result;
+  }();
+  return *sample;
+}
+
+ByteCounts CountOneTable(const std::vector<uint8_t>& data) {
+  ByteCounts counts;
+  counts.fill(0);
+  for (uint8_t c : data) {
+    ++counts[c];
+  }
+  return counts;
+}
+}  // namespace
+
+BENCHMARK(count_bytes_one_table) {
+  benchmark::DoNotOptimize(CountOneTable(Sample()));
+  SetBytesProcessed(Sample().size());
+}
+
+BENCHMARK(count_bytes_interleaved) {
+  benchmark::DoNotOptimize(CountBytes(Sample().data(), Sample().size()));
+  SetBytesProcessed(Sample().size());
+}
+
+BENCHMARK(count_bytes_4_threads) {
+  benchmark::DoNotOptimize(CountBytes(Sample().data(), Sample().size(), 4));
+  SetBytesProcessed(Sample().size());
+}
+
+}  // namespace huffman
@@ -0,0 +1,105 @@
+#include "histogram.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../base/testing.h"
+#include "huffman.h"
+
+namespace huffman {
+namespace {
+std::vector<uint8_t> Sample(size_t size) {
+  std::vector<uint8_t> result;
+  uint32_t value = 7;
+  for (size_t i = 0; i < size; ++i) {
+    value = value * 1103515245 + 12345;
+    // Runs of the same byte now and then.
+    result.push_back(i % 1000 < 100 ? 'x' : (value >> 16) % 40);
+  }
+  return result;
+}
+
+ByteCounts CountOneByOne(const std::vector<uint8_t>& data) {
+  ByteCounts counts;
+  counts.fill(0);
+  for (uint8_t c : data) {
+    ++counts[c];
+  }
+  return counts;
+}
+}  // namespace
+
+TEST(count_bytes_small) {
+  const std::string text = "hello world";
+  const ByteCounts counts = CountBytes(reinterpret_cast<const uint8_t*>(text.data()), 11);
+  ASSERT_EQ(3, counts['l']);
+  ASSERT_EQ(2, counts['o']);
+  ASSERT_EQ(1, counts[' ']);
+  ASSERT_EQ(0, counts['a']);
+
+  const ByteCounts none = CountBytes(nullptr, 0, 4);
+  ASSERT_TRUE(none == ByteCounts{});
+}
+
+TEST(count_bytes_all_sizes) {
+  const std::vector<uint8_t> data = Sample(100);
+  for (size_t size = 0; size <= data.size(); ++size) {
+    const std::vector<uint8_t> prefix(data.begin(), data.begin() + size);
+    ASSERT_TRUE(CountBytes(prefix.data(), size) == CountOneByOne(prefix));
+  }
+}
+
+TEST(count_bytes_threads) {
+  const std::vector<uint8_t> data = Sample(3 * kMinBytesPerThread + 123);
+  const ByteCounts expected = CountOneByOne(data);
+  for (size_t num_threads : {0, 1, 2, 3, 8}) {
+    ASSERT_TRUE(CountBytes(data.data(), data.size(), num_threads) == expected);
+  }
+}
+
+TEST(count_bytes_stream) {
+  const std::vector<uint8_t> data = Sample(kCountChunkSize + 1000);
+  std::istringstream input(std::string(data.begin(), data.end()));
+  ASSERT_TRUE(CountBytes(&input, 2) == CountOneByOne(data));
+
+  ByteCounts total = CountOneByOne(data);
+  AddCounts(CountOneByOne(data), &total);
+  ASSERT_EQ(2 * CountOneByOne(data)['x'], total['x']);
+}
+
+TEST(normalize_counts) {
+  ByteCounts counts{};
+  counts['a'] = 6;
+  counts['b'] = 3;
+  counts['z'] = 1;
+  std::vector<float> distribution;
+  std::vector<unsigned char> tokens;
+  NormalizeCounts(counts, &distribution, &tokens);
+  ASSERT_EQ(3, tokens.size());
+  ASSERT_EQ('b', tokens[1]);
+  ASSERT_EQ(0.6f, distribution[0]);
+  ASSERT_EQ(0.1f, distribution[2]);
+
+  NormalizeCounts(counts, &distribution, &tokens, 2);
+  ASSERT_EQ(2, tokens.size());
+  ASSERT_EQ(0.3f, distribution[1]);
+
+  NormalizeCounts(ByteCounts{}, &distribution, &tokens);
+  ASSERT_EMPTY(tokens);
+  ASSERT_EMPTY(distribution);
+}
+
+TEST(train_huffman_from_sample) {
+  const std::vector<uint8_t> data = Sample(10000);
+  std::vector<float> distribution;
+  std::vector<unsigned char> tokens;
+  NormalizeCounts(CountBytes(data.data(), data.size()), &distribution, &tokens);
+  const Huffman huff(distribution, tokens);
+  ASSERT_TRUE(huff.is_successful());
+  ASSERT_EQ(41, huff.VocabularySize());
+  // The runs make 'x' the most common byte.
+  ASSERT_LE(huff.Code('x').size(), huff.Code(0).size());
+}
+
+}  // namespace huffman
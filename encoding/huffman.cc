@@ -3,6 +3,7 @@
 
 #include <algorithm>
 #include <queue>
+#include <type_traits>
 #include <utility>
 
 #include "../base/container_utils.h"
@@ -11,38 +12,54 @@
 
 using Node = huffman::Huffman::HuffmanNode;
 using QueueElem = std::pair<float, size_t>;
+using bitstream::BitInStreamer;
 using bitstream::BitOutStreamer;
 
 namespace huffman {
 namespace {
 
+static_assert(std::is_trivially_copyable<Node>::value, "Nodes must copy as plain bytes");
+
 bool IsLeaf(const Node& node) {
-  return node.zero == nullptr && node.one == nullptr;
+  return node.zero == Node::kNone && node.one == Node::kNone;
 }
 
 bool IsRoot(const Node& node) {
-  return node.parent == nullptr;
+  return node.parent == Node::kNone;
+}
+
+// Length of the longest code below tree[index].
+int Height(const std::vector<Node>& tree, size_t index) {
+  const Node& node = tree[index];
+  if (IsLeaf(node)) return 0;
+  return 1 + std::max(Height(tree, node.zero), Height(tree, node.one));
 }
 
-bool IsParentConsistent(const Node& node) {
-  if (node.parent == &node) return false;
-  if (node.is_one) return !IsRoot(node) && node.parent->one == &node;
-  return IsRoot(node) || &node == node.parent->zero || &node == node.parent->one;
+bool IsParentConsistent(const std::vector<Node>& tree, size_t index) {
+  const Node& node = tree[index];
+  if (node.parent == index) return false;
+  if (IsRoot(node)) return !node.is_one;
+  if (node.parent >= tree.size()) return false;
+  const Node& parent = tree[node.parent];
+  if (node.is_one) return parent.one == index;
+  return parent.zero == index || parent.one == index;
 }
 
-bool AreChildrenConsistent(const Node& node) {
-  if (node.zero && node.zero->parent != &node) return false; 
-  if (node.one && node.one->parent != &node) return false; 
+bool AreChildrenConsistent(const std::vector<Node>& tree, size_t index) {
+  for (uint16_t child : {tree[index].zero, tree[index].one}) {
+    if (child == Node::kNone) continue;
+    if (child >= tree.size() || tree[child].parent != index) return false;
+  }
   return true;
 }
 
 bool IsConsistent(const std::vector<Node>& tree, size_t book_size) {
-  if (tree.size() != 2 * book_size - 1) {
+  if (tree.size() != 2 * book_size - 1 || tree.size() >= Node::kNone) {
     return false;
   }
   for (size_t i = 0; i < tree.size(); ++i) {
-    if (!IsParentConsistent(tree[i])) return false;
-    if (!AreChildrenConsistent(tree[i])) return false;
+    if (!IsParentConsistent(tree, i)) return false;
+    if (!AreChildrenConsistent(tree, i)) return false;
 
     bool expect_leaf = i < book_size;
     if (expect_leaf != IsLeaf(tree[i])) return false;
@@ -93,10 +110,10 @@ bool ConstructHuffmanNodes(const std::vector<float>& distribution, std::vector<N
     CHECK(next_empty_node < out->size());
     Node* parent = &(*out)[next_empty_node];
 
-    lower_node->parent = parent;
-    low_node->parent = parent;
-    parent->zero = low_node;
-    parent->one = lower_node;
+    lower_node->parent = next_empty_node;
+    low_node->parent = next_empty_node;
+    parent->zero = low.second;
+    parent->one = lower.second;
     lower_node->is_one = true;
 
     queue.emplace(lower.first + low.first, next_empty_node);
@@ -105,6 +122,135 @@ bool ConstructHuffmanNodes(const std::vector<float>& distribution, std::vector<N
   return IsConsistent(*out, book_size);
 }
 
+// Returns false if `max_length` bits cannot hold a code for every token.
+// Otherwise sets (*lengths)[i] to the code length for distribution[i], such
+// that no code is longer than `max_length` and the expected code length is
+// as short as possible. Uses package-merge: each level pairs the cheapest
+// items of the level below into packages and merges them with the leaves.
+bool LengthLimitedCodeLengths(const std::vector<float>& distribution, int max_length,
+                              std::vector<int>* lengths) {
+  const size_t book_size = distribution.size();
+  lengths->assign(book_size, 0);
+  if (book_size <= 1) return true;
+  if (max_length <= 0) return false;
+  if (max_length < 64 && (size_t(1) << max_length) < book_size) return false;
+  // Longer codes than book_size - 1 are never needed.
+  const size_t levels = std::min<size_t>(max_length, book_size - 1);
+
+  std::vector<size_t> order(book_size);
+  for (size_t i = 0; i < book_size; ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&distribution](size_t a, size_t b) {
+    return distribution[a] < distribution[b];
+  });
+
+  // is_package[level] tells, for the items of that level by weight, which
+  // are packages. Leaves come out in `order` on every level.
+  std::vector<std::vector<bool>> is_package(levels);
+  std::vector<double> weights;
+  for (size_t level = levels; level-- > 0;) {
+    std::vector<double> packages;
+    for (size_t i = 0; i + 1 < weights.size(); i += 2) {
+      packages.push_back(weights[i] + weights[i + 1]);
+    }
+    std::vector<double> merged;
+    size_t leaf = 0;
+    size_t package = 0;
+    while (leaf < book_size || package < packages.size()) {
+      if (package == packages.size() ||
+          (leaf < book_size && distribution[order[leaf]] <= packages[package])) {
+        merged.push_back(distribution[order[leaf++]]);
+        is_package[level].push_back(false);
+      } else {
+        merged.push_back(packages[package++]);
+        is_package[level].push_back(true);
+      }
+    }
+    weights.swap(merged);
+  }
+
+  // The cheapest 2N - 2 items of the top level make the code. Every leaf
+  // among the chosen items, or inside a chosen package, adds one bit to its
+  // code, and the chosen leaves of a level are always the cheapest ones.
+  size_t chosen = 2 * book_size - 2;
+  for (size_t level = 0; level < levels && chosen > 0; ++level) {
+    size_t num_leaves = 0;
+    for (size_t i = 0; i < chosen; ++i) {
+      if (!is_package[level][i]) ++num_leaves;
+    }
+    for (size_t i = 0; i < num_leaves; ++i) {
+      ++(*lengths)[order[i]];
+    }
+    chosen = 2 * (chosen - num_leaves);
+  }
+  return true;
+}
+
+// Length of the code of tree[index].
+int Depth(const std::vector<Node>& tree, size_t index) {
+  int depth = 0;
+  for (; !IsRoot(tree[index]); index = tree[index].parent) {
+    ++depth;
+  }
+  return depth;
+}
+
+// Returns false unless `lengths` describe a complete prefix code.
+// Like ConstructHuffmanNodes, leaf i of `out` has code length lengths[i] and
+// the root is last. Leaves of the same length are ordered by `keys`.
+bool ConstructCanonicalNodes(const std::vector<int>& lengths, const std::vector<int>& keys,
+                             std::vector<Node>* out) {
+  const size_t book_size = lengths.size();
+  if (book_size == 0) return false;
+  out->assign(2 * book_size - 1, Node());
+  if (book_size == 1) return lengths[0] == 0;
+
+  std::vector<size_t> order;
+  for (size_t i = 0; i < book_size; ++i) {
+    if (lengths[i] <= 0) return false;
+    order.push_back(i);
+  }
+  std::sort(order.begin(), order.end(), [&lengths, &keys](size_t a, size_t b) {
+    if (lengths[a] != lengths[b]) return lengths[a] < lengths[b];
+    if (keys[a] != keys[b]) return keys[a] < keys[b];
+    return a < b;
+  });
+
+  // Builds the tree from the deepest level up. At each depth the leaves
+  // come first, then the internal nodes over the level below, and each pair
+  // of neighbours gets a parent.
+  std::vector<size_t> level;
+  size_t end = book_size;  // Leaves in order[0, end) are not placed yet.
+  size_t next_internal = book_size;
+  for (int depth = lengths[order.back()]; depth >= 1; --depth) {
+    size_t begin = end;
+    while (begin > 0 && lengths[order[begin - 1]] == depth) {
+      --begin;
+    }
+    std::vector<size_t> nodes(order.begin() + begin, order.begin() + end);
+    nodes.insert(nodes.end(), level.begin(), level.end());
+    end = begin;
+    if (nodes.size() % 2 != 0) return false;
+
+    level.clear();
+    for (size_t i = 0; i < nodes.size(); i += 2) {
+      if (next_internal >= out->size()) return false;
+      Node* parent = &(*out)[next_internal];
+      Node* zero = &(*out)[nodes[i]];
+      Node* one = &(*out)[nodes[i + 1]];
+      zero->parent = next_internal;
+      one->parent = next_internal;
+      parent->zero = nodes[i];
+      parent->one = nodes[i + 1];
+      one->is_one = true;
+      level.push_back(next_internal);
+      ++next_internal;
+    }
+  }
+  return end == 0 && level.size() == 1 && IsConsistent(*out, book_size);
+}
+
 // Distribution of English letters in percentage.
 static const float kEnglishLetterDistribution[] = {
   8.167,   // a
@@ -145,10 +291,12 @@ std::vector<unsigned char> VectorFromString(const std::string& str) {
 
 }  // namespace
 
-Huffman::Huffman(std::vector<float> distribution, const std::string& tokens)
-    : Huffman(std::move(distribution), VectorFromString(tokens)) {}
+Huffman::Huffman(std::vector<float> distribution, const std::string& tokens,
+                 int max_code_length)
+    : Huffman(std::move(distribution), VectorFromString(tokens), max_code_length) {}
 
-Huffman::Huffman(std::vector<float> distribution, const std::vector<unsigned char>& tokens) {
+Huffman::Huffman(std::vector<float> distribution, const std::vector<unsigned char>& tokens,
+                 int max_code_length) {
   if (distribution.size() != tokens.size()) {
     successful_ = false;
     return;
@@ -157,41 +305,488 @@ Huffman::Huffman(std::vector<float> distribution, const std::vector<unsigned cha
     token_map_.emplace(tokens[i], i);
   }
   distribution.push_back(0.0f);  // for Escape token.
-  successful_ = ConstructHuffmanNodes(distribution, &nodes_);
+  if (max_code_length > 0) {
+    std::vector<int> lengths;
+    std::vector<int> keys(tokens.begin(), tokens.end());
+    keys.push_back(kEscapeEntry);
+    successful_ = LengthLimitedCodeLengths(distribution, max_code_length, &lengths) &&
+                  ConstructCanonicalNodes(lengths, keys, &nodes_);
+  } else {
+    successful_ = ConstructHuffmanNodes(distribution, &nodes_) && MakeCanonical(tokens);
+  }
+  if (successful_) {
+    BuildCodeTable();
+    BuildDecodeTable();
+  }
+}
+
+Huffman::Huffman(const uint8_t* code_book, size_t size) : successful_(false) {
+  if (code_book == nullptr || size != kCodeBookSize) return;
+  std::vector<int> lengths;
+  std::vector<int> keys;
+  for (size_t token = 0; token < 256; ++token) {
+    const int length = (code_book[token / 2] >> (token % 2 == 0 ? 4 : 0)) & 0xF;
+    if (length == 0) continue;
+    token_map_.emplace(token, lengths.size());
+    lengths.push_back(length);
+    keys.push_back(token);
+  }
+  lengths.push_back(code_book[kCodeBookSize - 1]);  // for Escape token.
+  keys.push_back(kEscapeEntry);
+  successful_ = ConstructCanonicalNodes(lengths, keys, &nodes_);
+  if (successful_) {
+    BuildCodeTable();
+    BuildDecodeTable();
+  }
+}
+
+bool Huffman::MakeCanonical(const std::vector<unsigned char>& tokens) {
+  std::vector<int> lengths;
+  std::vector<int> keys(tokens.begin(), tokens.end());
+  keys.push_back(kEscapeEntry);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    lengths.push_back(Depth(nodes_, i));
+  }
+  return ConstructCanonicalNodes(lengths, keys, &nodes_);
+}
+
+double Huffman::AverageCodeLength(const std::vector<float>& distribution) const {
+  double total = 0.0;
+  double weighted = 0.0;
+  for (size_t i = 0; i < distribution.size() && i < VocabularySize(); ++i) {
+    total += distribution[i];
+    weighted += double(distribution[i]) * Depth(nodes_, i);
+  }
+  return total > 0.0 ? weighted / total : 0.0;
+}
+
+bool Huffman::SerializeCodeBook(std::vector<uint8_t>* code_book) const {
+  // Leaves of repeated tokens are not in token_map_.
+  if (!successful_ || nodes_.size() != 2 * VocabularySize() + 1) return false;
+  code_book->assign(kCodeBookSize, 0);
+  for (const auto& token_and_index : token_map_) {
+    const int length = Depth(nodes_, token_and_index.second);
+    if (length > kMaxCodeBookLength) return false;
+    const unsigned char token = token_and_index.first;
+    (*code_book)[token / 2] |= length << (token % 2 == 0 ? 4 : 0);
+  }
+  const int escape_length = Depth(nodes_, VocabularySize());
+  if (escape_length > 255) return false;
+  code_book->back() = escape_length;
+  return true;
+}
+
+void Huffman::BuildCodeTable() {
+  // Returns the full code length, keeping only the last 64 bits in `bits`.
+  auto leaf_code = [this](size_t leaf_index, uint64_t* bits) {
+    int length = 0;
+    *bits = 0;
+    for (size_t node = leaf_index; !IsRoot(nodes_[node]); node = nodes_[node].parent) {
+      if (length < 64) *bits |= uint64_t(nodes_[node].is_one) << length;
+      ++length;
+    }
+    return length;
+  };
+
+  uint64_t escape_bits = 0;
+  const int escape_length = leaf_code(VocabularySize(), &escape_bits);
+  if (escape_length <= 64) {
+    code_table_[kEscapeEntry].bits = escape_bits;
+    code_table_[kEscapeEntry].length = escape_length;
+  }
+  for (size_t token = 0; token < kEscapeEntry; ++token) {
+    CodeEntry& entry = code_table_[token];
+    auto it = token_map_.find(token);
+    if (it != token_map_.end()) {
+      const int length = leaf_code(it->second, &entry.bits);
+      entry.length = length <= 64 ? length : 0;
+    } else if (escape_length <= 56) {
+      entry.bits = (escape_bits << 8) | token;
+      entry.length = escape_length + 8;
+    }
+  }
+  max_encoded_length_ = 0;
+  for (size_t token = 0; token < kEscapeEntry; ++token) {
+    max_encoded_length_ = std::max(max_encoded_length_, EncodedLength(token));
+  }
 }
 
-void AddCodeToBuffer(const Node& node, BitOutStreamer* out) {
+void Huffman::BuildDecodeTable() {
+  // Token of each leaf. Leaves of repeated tokens are never encoded.
+  const size_t book_size = (nodes_.size() + 1) / 2;
+  std::vector<uint32_t> leaf_tokens(book_size, kEscapeEntry);
+  for (const auto& token_and_index : token_map_) {
+    leaf_tokens[token_and_index.second] = token_and_index.first;
+  }
+
+  const size_t root = nodes_.size() - 1;
+  primary_bits_ = std::min(Height(nodes_, root), kDecodeTableBits);
+  decode_table_.assign(size_t(1) << primary_bits_, DecodeEntry());
+  FillDecodeTable(root, primary_bits_, 0, leaf_tokens);
+
+  // Pairs each short code with the code in the bits after it, if that one
+  // also ends within the index bits.
+  auto is_plain_token = [](const DecodeEntry& entry) {
+    return entry.subtable_bits == 0 && entry.value != kEscapeEntry;
+  };
+  const size_t primary_size = size_t(1) << primary_bits_;
+  fast_table_.assign(primary_size, FastEntry());
+  single_table_.assign(primary_size, 0);
+  for (size_t index = 0; index < primary_size; ++index) {
+    const DecodeEntry& first = decode_table_[index];
+    if (!is_plain_token(first)) continue;
+    single_table_[index] = first.value | (first.length << 8);
+    FastEntry& fast = fast_table_[index];
+    fast.tokens[0] = first.value;
+    fast.length = first.length;
+    fast.num_tokens = 1;
+
+    const DecodeEntry& second = decode_table_[(index << first.length) & (primary_size - 1)];
+    if (is_plain_token(second) && first.length + second.length <= primary_bits_) {
+      fast.tokens[1] = second.value;
+      fast.length += second.length;
+      fast.num_tokens = 2;
+    }
+  }
+}
+
+void Huffman::FillDecodeTable(size_t node, int bits, size_t offset,
+                              const std::vector<uint32_t>& leaf_tokens) {
+  for (size_t index = 0; index < (size_t(1) << bits); ++index) {
+    // Follows the bits of index from node, most significant first.
+    size_t current = node;
+    int length = 0;
+    while (length < bits && !IsLeaf(nodes_[current])) {
+      const bool bit = (index >> (bits - 1 - length)) & 1;
+      current = bit ? nodes_[current].one : nodes_[current].zero;
+      ++length;
+    }
+
+    DecodeEntry entry;
+    entry.length = length;
+    if (IsLeaf(nodes_[current])) {
+      entry.value = leaf_tokens[current];
+    } else {
+      // Every index reaching here ends at a different node.
+      entry.subtable_bits = std::min(Height(nodes_, current), kDecodeTableBits);
+      entry.value = decode_table_.size();
+      decode_table_.resize(decode_table_.size() + (size_t(1) << entry.subtable_bits));
+      FillDecodeTable(current, entry.subtable_bits, entry.value, leaf_tokens);
+    }
+    decode_table_[offset + index] = entry;
+  }
+}
+
+void AddCodeToBuffer(const std::vector<Node>& tree, size_t index, BitOutStreamer* out) {
   // Root node should not add to code.
-  if (IsRoot(node)) return;
+  if (IsRoot(tree[index])) return;
   // Add bits of parent first so order is preserved.
-  AddCodeToBuffer(*node.parent, out);
-  out->PushBit(node.is_one);
+  AddCodeToBuffer(tree, tree[index].parent, out);
+  out->PushBit(tree[index].is_one);
+}
+
+void Huffman::EncodeTokens(const uint8_t* data, size_t size, BitOutStreamer* out) const {
+  // Codes are gathered in a local word and pushed 64 bits at a time.
+  uint64_t pending = 0;
+  int num_pending = 0;
+  for (size_t i = 0; i < size; ++i) {
+    const unsigned char in_token = data[i];
+    const CodeEntry& entry = code_table_[in_token];
+    if (entry.length > 0) {
+      if (num_pending + entry.length > 64) {
+        out->PushBits(pending, num_pending);
+        pending = 0;
+        num_pending = 0;
+      }
+      // Shifting by 64 is undefined, but then pending is 0 anyway.
+      pending = entry.length < 64 ? (pending << entry.length) | entry.bits : entry.bits;
+      num_pending += entry.length;
+      continue;
+    }
+    // Code longer than 64 bits.
+    out->PushBits(pending, num_pending);
+    pending = 0;
+    num_pending = 0;
+    AddCodeToBuffer(nodes_, IndexOfToken(in_token), out);
+    if (!util::ContainsKey(token_map_, in_token)) {
+      // Add original unsigned char after Escape code
+      out->PushByte(in_token);
+    }
+  }
+  out->PushBits(pending, num_pending);
 }
 
 bool Huffman::Encode(std::istream* input, std::ostream* output) const {
   if (input == nullptr || output == nullptr) return false;
 
   BitOutStreamer output_buffer(output);
-  /*
-  unsigned char in_token = '\000';
-  while ((in_token = input->get()) != EOF) {
-  */
-  for (unsigned char in_token = input->get(); !input->eof(); in_token = input->get()) {
-    size_t leaf_index = IndexOfToken(in_token);
-    AddCodeToBuffer(nodes_[leaf_index], &output_buffer);
-    if (!util::ContainsKey(token_map_, in_token)) {
-      // Add original unsigned char after Escape code
-      output_buffer.PushByte(in_token);
-    }
+  const size_t kChunkSize = 1 << 16;
+  std::vector<char> chunk(kChunkSize);
+  while (*input) {
+    input->read(chunk.data(), kChunkSize);
+    EncodeTokens(reinterpret_cast<const uint8_t*>(chunk.data()), input->gcount(),
+                 &output_buffer);
   }
   output_buffer.FlushRemaining();
   return true;
 }
 
+uint32_t Huffman::DecodeToken(BitInStreamer* in) const {
+  const DecodeEntry* table = decode_table_.data();
+  DecodeEntry entry = table[in->PeekBits(primary_bits_)];
+  while (entry.subtable_bits != 0) {
+    in->ConsumeBits(entry.length);
+    entry = table[entry.value + in->PeekBits(entry.subtable_bits)];
+  }
+  in->ConsumeBits(entry.length);
+  return entry.value;
+}
+
+bool Huffman::DecodeTokens(BitInStreamer* in, size_t num_tokens, uint8_t* output) const {
+  const int kPeekBits = BitInStreamer::kMaxBits;
+  const FastEntry* fast_table = fast_table_.data();
+  const uint64_t mask = (uint64_t(1) << primary_bits_) - 1;
+  size_t i = 0;
+  while (i < num_tokens) {
+    // Decodes short codes, up to two per lookup, from as many bits as one
+    // peek returns. Leaves room for writing two tokens.
+    const uint64_t bits = in->PeekBits(kPeekBits);
+    int used = 0;
+    FastEntry fast;
+    while (i + 1 < num_tokens && used + primary_bits_ <= kPeekBits) {
+      fast = fast_table[(bits >> (kPeekBits - primary_bits_ - used)) & mask];
+      if (fast.num_tokens == 0) break;
+      output[i] = fast.tokens[0];
+      output[i + 1] = fast.tokens[1];
+      i += fast.num_tokens;
+      used += fast.length;
+    }
+    in->ConsumeBits(used);
+    if (i + 1 < num_tokens && fast.num_tokens != 0) continue;
+    if (i == num_tokens) break;
+
+    const uint32_t token = DecodeToken(in);
+    // Escape code is followed by the original unsigned char.
+    output[i++] = token == kEscapeEntry ? in->ReadBits(8) : token;
+  }
+  return !in->overrun();
+}
+
+void Huffman::EncodeFourStreams(const uint8_t* data, size_t size,
+                                std::vector<uint8_t>* out) const {
+  const size_t jump_table = out->size();
+  out->resize(jump_table + kJumpTableSize);
+  const size_t segment = (size + 3) / 4;
+  bitstream::VectorSink sink(out);
+  size_t stream_start = out->size();
+  for (size_t s = 0; s < 4; ++s) {
+    const size_t begin = std::min(s * segment, size);
+    const size_t end = s == 3 ? size : std::min(begin + segment, size);
+    {
+      BitOutStreamer stream(&sink);
+      EncodeTokens(data + begin, end - begin, &stream);
+      stream.FlushRemaining();
+    }
+    if (s == 3) break;
+    const uint64_t stream_size = out->size() - stream_start;
+    for (size_t byte = 0; byte < 4; ++byte) {
+      (*out)[jump_table + 4 * s + byte] = stream_size >> (24 - 8 * byte);
+    }
+    stream_start = out->size();
+  }
+}
+
+// Refill loads 8 bytes at once and must stay 8 bytes from the end.
+struct Huffman::FourStreamReader {
+  const uint8_t* begin = nullptr;
+  size_t size = 0;
+  const uint8_t* next = nullptr;
+  uint64_t window = 0;  // Next bits to consume are the most significant.
+  int bits = 0;
+
+  void Start(const uint8_t* data, size_t data_size) {
+    begin = data;
+    size = data_size;
+    next = data;
+  }
+  size_t BytesLeft() const { return size - (next - begin); }
+  uint64_t BitsConsumed() const { return 8 * uint64_t(next - begin) - bits; }
+  // Fills the window to at least 56 bits. Loads the byte holding the bits
+  // after the window and as many whole bytes after it as fit.
+  void Refill() {
+    window |= bitstream::internal::LoadBigEndian64(next) >> bits;
+    next += (63 - bits) >> 3;
+    bits |= 56;
+  }
+  // 1 <= n <= bits.
+  uint64_t Peek(int n) const { return window >> (64 - n); }
+  void Consume(int n) {
+    window <<= n;
+    bits -= n;
+  }
+};
+
+bool Huffman::DecodeFourStreams(const uint8_t* data, size_t size, size_t num_tokens,
+                                uint8_t* output) const {
+  if (!successful_ || size < kJumpTableSize) return false;
+  FourStreamReader readers[4];
+  const uint8_t* next = data + kJumpTableSize;
+  size_t remaining = size - kJumpTableSize;
+  for (size_t s = 0; s < 3; ++s) {
+    const uint8_t* entry = data + 4 * s;
+    const size_t stream_size =
+        (size_t(entry[0]) << 24) | (entry[1] << 16) | (entry[2] << 8) | entry[3];
+    if (stream_size > remaining) return false;
+    readers[s].Start(next, stream_size);
+    next += stream_size;
+    remaining -= stream_size;
+  }
+  readers[3].Start(next, remaining);
+
+  const size_t segment = (num_tokens + 3) / 4;
+  uint8_t* out[4];
+  uint8_t* end[4];
+  for (size_t s = 0; s < 4; ++s) {
+    out[s] = output + std::min(s * segment, num_tokens);
+    end[s] = s == 3 ? output + num_tokens : std::min(out[s] + segment, output + num_tokens);
+  }
+
+  // The four streams do not depend on each other, so the CPU overlaps their
+  // lookups. Each round refills every window to at least 56 bits and then
+  // decodes as many primary table codes from each as surely fit. Long codes
+  // and Escape take the slow path, which refills before each step.
+  if (primary_bits_ > 0) {
+    const uint16_t* table = single_table_.data();
+    const int primary_bits = primary_bits_;
+    const size_t per_round = 56 / primary_bits;
+    // A code is at most 256 bits, plus 8 for an escaped byte.
+    const size_t margin = 8 + 33 * per_round;
+    size_t tokens_left = num_tokens;
+    for (size_t s = 0; s < 4; ++s) {
+      tokens_left = std::min<size_t>(tokens_left, end[s] - out[s]);
+    }
+    // Local copies, so the compiler keeps them in registers.
+    FourStreamReader r0 = readers[0];
+    FourStreamReader r1 = readers[1];
+    FourStreamReader r2 = readers[2];
+    FourStreamReader r3 = readers[3];
+    auto decode_one = [this, table, primary_bits](FourStreamReader& reader) -> uint8_t {
+      const uint16_t entry = table[reader.Peek(primary_bits)];
+      if (entry != 0) {
+        reader.Consume(entry >> 8);
+        return entry;
+      }
+      FourStreamReader copy = reader;
+      const uint8_t token = DecodeTokenSlow(&copy);
+      reader = copy;
+      return token;
+    };
+    size_t done = 0;
+    while (done + per_round <= tokens_left && r0.BytesLeft() >= margin &&
+           r1.BytesLeft() >= margin && r2.BytesLeft() >= margin && r3.BytesLeft() >= margin) {
+      r0.Refill();
+      r1.Refill();
+      r2.Refill();
+      r3.Refill();
+      for (size_t i = 0; i < per_round; ++i, ++done) {
+        out[0][done] = decode_one(r0);
+        out[1][done] = decode_one(r1);
+        out[2][done] = decode_one(r2);
+        out[3][done] = decode_one(r3);
+      }
+    }
+    readers[0] = r0;
+    readers[1] = r1;
+    readers[2] = r2;
+    readers[3] = r3;
+    for (size_t s = 0; s < 4; ++s) {
+      out[s] += done;
+    }
+  }
+
+  // The rest of each stream, with bounds checks.
+  for (size_t s = 0; s < 4; ++s) {
+    const uint64_t consumed = readers[s].BitsConsumed();
+    const size_t skip = std::min<uint64_t>(consumed / 8, readers[s].size);
+    BitInStreamer in(readers[s].begin + skip, readers[s].size - skip);
+    in.PeekBits(consumed % 8);
+    in.ConsumeBits(consumed % 8);
+    if (!DecodeTokens(&in, end[s] - out[s], out[s])) return false;
+  }
+  return true;
+}
+
+uint8_t Huffman::DecodeTokenSlow(FourStreamReader* reader) const {
+  reader->Refill();
+  DecodeEntry entry = decode_table_[reader->Peek(primary_bits_)];
+  while (entry.subtable_bits != 0) {
+    reader->Consume(entry.length);
+    reader->Refill();
+    entry = decode_table_[entry.value + reader->Peek(entry.subtable_bits)];
+  }
+  reader->Consume(entry.length);
+  reader->Refill();
+  if (entry.value != kEscapeEntry) return entry.value;
+  // Escape code is followed by the original unsigned char.
+  const uint8_t token = reader->Peek(8);
+  reader->Consume(8);
+  reader->Refill();
+  return token;
+}
+
+bool Huffman::Decode(std::istream* input, std::ostream* output, size_t num_tokens) const {
+  if (input == nullptr || output == nullptr || !successful_) return false;
+
+  BitInStreamer input_buffer(input);
+  const size_t kChunkSize = 1 << 16;
+  std::vector<uint8_t> chunk(kChunkSize);
+  while (num_tokens > 0) {
+    const size_t size = std::min(num_tokens, kChunkSize);
+    if (!DecodeTokens(&input_buffer, size, chunk.data())) return false;
+    output->write(reinterpret_cast<const char*>(chunk.data()), size);
+    num_tokens -= size;
+  }
+  return bool(*output);
+}
+
+bool Huffman::Decode(const uint8_t* data, size_t size, size_t num_tokens,
+                     uint8_t* output) const {
+  if (!successful_) return false;
+  BitInStreamer input_buffer(data, size);
+  return DecodeTokens(&input_buffer, num_tokens, output);
+}
+
+bool Huffman::Decode(const uint8_t* data, size_t size, size_t num_tokens,
+                     std::vector<uint8_t>* out) const {
+  const size_t start = out->size();
+  out->resize(start + num_tokens);
+  if (Decode(data, size, num_tokens, out->data() + start)) return true;
+  out->resize(start);
+  return false;
+}
+
+size_t Huffman::MaxCompressedSize(size_t size) const {
+  return (uint64_t(size) * max_encoded_length_ + 7) / 8;
+}
+
+size_t Huffman::Encode(const uint8_t* data, size_t size, uint8_t* out) const {
+  bitstream::SpanSink sink(out, MaxCompressedSize(size));
+  BitOutStreamer bits(&sink);
+  EncodeTokens(data, size, &bits);
+  bits.FlushRemaining();
+  return sink.size();
+}
+
+void Huffman::Encode(const uint8_t* data, size_t size, std::vector<uint8_t>* out) const {
+  const size_t start = out->size();
+  out->resize(start + MaxCompressedSize(size));
+  out->resize(start + Encode(data, size, out->data() + start));
+}
+
 std::string Huffman::CodeInternal(size_t leaf_index) const {
   std::string result;
-  for (const Node* node = &nodes_[leaf_index]; !IsRoot(*node); node = node->parent) {
-    if (node->is_one) {
+  for (size_t node = leaf_index; !IsRoot(nodes_[node]); node = nodes_[node].parent) {
+    if (nodes_[node].is_one) {
       result.push_back('1');
     } else {
       result.push_back('0');
@@ -230,6 +825,11 @@ std::string Huffman::Encoded(unsigned char token) const {
   return encoded;
 }
 
+int Huffman::EncodedLength(unsigned char token) const {
+  const int length = code_table_[token].length;
+  return length > 0 ? length : Encoded(token).size();
+}
+
 std::vector<float> EnglishLetterDistribution() {
   std::vector<float> result;
   for (size_t i = 0; i < 26; ++i) {
@@ -1,31 +1,56 @@
 #ifndef HUFFMAN_H
 #define HUFFMAN_H
 
+#include <array>
+#include <cstdint>
 #include <iostream>
 #include <map>
 #include <string>
 #include <vector>
 
-namespace huffman {
+namespace bitstream {
+class BitInStreamer;
+class BitOutStreamer;
+}  // namespace bitstream
 
-// TODO Implement functions for
-// * decoding
-// * taking sample of text -> distribution.
-// * storing and loading code book
+namespace huffman {
 
-// Main program should be able to
-// * Read text, produce distribution, output code book to stdout.
-// * Load code book from file, encode stdin > stdout.
-// * Load code book from file, decode stdin > stdout.
+// See huffman_main.cc for a command line tool that trains code books and
+// encodes and decodes stdin to stdout.
 
+// Distributions can be counted from sample text, see histogram.h.
+//
+// Codes are canonical: codes of the same length are consecutive binary
+// numbers in token order, with the Escape code last, and shorter codes come
+// first. So the code lengths alone describe the code, see SerializeCodeBook.
 class Huffman {
  public:
-  // TODO build error string as member?
-  Huffman(std::vector<float> distribution, const std::vector<unsigned char>& tokens);
-  Huffman(std::vector<float> distribution, const std::string& tokens);
+  // Size of a serialized code book: 256 nibbles with the code length of each
+  // unsigned char, 0 if unknown, then one byte with the Escape code length.
+  static constexpr size_t kCodeBookSize = 129;
+  // Longest code a code book can hold, except for the Escape code.
+  static constexpr int kMaxCodeBookLength = 15;
+  // Bits used to index decoding tables, at most. Longer codes decode slower.
+  static constexpr int kDecodeTableBits = 11;
 
-  // Must implement deep copy if we want to copy this class.
-  Huffman(const Huffman&) = delete;
+  // TODO build error string as member?
+  // If max_code_length > 0, no code is longer than that, at a small cost in
+  // compression. Not successful if there are too many tokens for it.
+  // Limiting codes to kDecodeTableBits keeps Decode on its primary tables,
+  // and to kMaxCodeBookLength makes SerializeCodeBook always succeed.
+  Huffman(std::vector<float> distribution, const std::vector<unsigned char>& tokens,
+          int max_code_length = 0);
+  Huffman(std::vector<float> distribution, const std::string& tokens,
+          int max_code_length = 0);
+  // Loads a code book written by SerializeCodeBook.
+  // Not successful unless it holds a complete prefix code.
+  Huffman(const uint8_t* code_book, size_t size);
+
+  // Plain member-wise copies, the tree holds no pointers.
+  Huffman(const Huffman&) = default;
+  Huffman(Huffman&&) = default;
+  Huffman& operator=(const Huffman&) = default;
+  Huffman& operator=(Huffman&&) = default;
 
   bool is_successful() const { return successful_; }
 
@@ -40,28 +65,125 @@ class Huffman {
   // Otherwise, simply returns Code(token).
   std::string Encoded(unsigned char token) const;
 
+  // Same as Encoded(token).size(), but cheap.
+  int EncodedLength(unsigned char token) const;
+
   // Code used for Escaping unknown unsigned chars.
   // Will always be the longest code.
   std::string EscapeCode() const;
 
+  // Expected bits per token, with distribution[i] the weight of tokens[i]
+  // as given to the constructor. Escapes are not counted.
+  double AverageCodeLength(const std::vector<float>& distribution) const;
+
+  // Writes the code lengths, see kCodeBookSize.
+  // Returns false if a code is longer than kMaxCodeBookLength or the tokens
+  // given to the constructor repeat.
+  bool SerializeCodeBook(std::vector<uint8_t>* code_book) const;
+
   bool Encode(std::istream* input, std::ostream* output) const;
-  // bool Decode(std::istream* input, std::ostream* output) const;
 
-  /*
-  std::string Encode(const std::string& plain_text) const;
-  std::string Decode(const std::string& encoded_text) const;
-  */
+  // Decodes `num_tokens` tokens from the output of Encode.
+  // The encoded bits do not record how many tokens they hold, and the zero
+  // bits padding the last byte may decode as tokens too, so the count must
+  // be known. Returns false if the input ends before that.
+  bool Decode(std::istream* input, std::ostream* output, size_t num_tokens) const;
+  // Same, from `size` bytes at `data` into `num_tokens` bytes at `output`.
+  bool Decode(const uint8_t* data, size_t size, size_t num_tokens, uint8_t* output) const;
+
+  // Pushes the codes of the `size` bytes at `data` to `out`, without
+  // padding. For formats that frame the encoded bits themselves.
+  void EncodeTokens(const uint8_t* data, size_t size, bitstream::BitOutStreamer* out) const;
+  // Decodes `num_tokens` tokens from `in` into `output`, as pushed by
+  // EncodeTokens. Returns false if `in` ends before that.
+  bool DecodeTokens(bitstream::BitInStreamer* in, size_t num_tokens, uint8_t* output) const;
+
+  // Four-stream format of one block, for faster decoding. The tokens are
+  // split in four segments of (size + 3) / 4, the last holding the rest,
+  // each encoded into its own byte-aligned stream. A jump table of the
+  // sizes of the first three streams, 32-bit big-endian, comes first:
+  // [size 0][size 1][size 2][stream 0][stream 1][stream 2][stream 3]
+  // The decoder then keeps four independent bit readers in flight.
+  static constexpr size_t kJumpTableSize = 12;
+  // Appends the four streams of the `size` bytes at `data` to `out`.
+  void EncodeFourStreams(const uint8_t* data, size_t size, std::vector<uint8_t>* out) const;
+  // Decodes `num_tokens` tokens from the output of EncodeFourStreams.
+  bool DecodeFourStreams(const uint8_t* data, size_t size, size_t num_tokens,
+                         uint8_t* output) const;
+
+  // Most bytes Encode writes for `size` bytes of input, so callers can
+  // allocate the output up front.
+  size_t MaxCompressedSize(size_t size) const;
+  // Appends the codes of the `size` bytes at `data` to `out`, padded to a
+  // byte. Grows `out` at most once.
+  void Encode(const uint8_t* data, size_t size, std::vector<uint8_t>* out) const;
+  // Same into `out`, which must hold MaxCompressedSize(size) bytes.
+  // Returns the number of bytes written.
+  size_t Encode(const uint8_t* data, size_t size, uint8_t* out) const;
+  // Appends `num_tokens` decoded tokens to `out`, see Decode above.
+  bool Decode(const uint8_t* data, size_t size, size_t num_tokens,
+              std::vector<uint8_t>* out) const;
 
   // Internal
+  // Nodes link by index into nodes_, so the tree is one position independent
+  // block that copies with the vector.
   struct HuffmanNode {
-    HuffmanNode* parent = nullptr;
-    HuffmanNode* zero = nullptr;
-    HuffmanNode* one = nullptr;
+    static constexpr uint16_t kNone = 0xFFFF;
+    uint16_t parent = kNone;
+    uint16_t zero = kNone;
+    uint16_t one = kNone;
     // Redundant information but makes encoding slightly faster and easier to read:
     bool is_one = false;
   };
 
  private:
+  // Code bits of one table entry, right aligned.
+  struct CodeEntry {
+    uint64_t bits = 0;
+    // 0 if the code does not fit in 64 bits, then Encode walks the tree.
+    int length = 0;
+  };
+  // Table entry of the Escape code alone.
+  static constexpr size_t kEscapeEntry = 256;
+
+  // Rebuilds nodes_ as the canonical code with the same code lengths.
+  // Leaf i belongs to tokens[i], or the Escape token after them.
+  bool MakeCanonical(const std::vector<unsigned char>& tokens);
+
+  // Fills code_table_ from nodes_.
+  void BuildCodeTable();
+
+  // One entry of the decoding tables. The primary table is indexed by the
+  // next primary_bits_ bits of input. Codes longer than that continue in a
+  // subtable indexed by the bits after them, and so on.
+  struct DecodeEntry {
+    uint32_t value = 0;  // Token, kEscapeEntry, or where the subtable starts.
+    uint8_t length = 0;  // Bits consumed by this entry.
+    uint8_t subtable_bits = 0;  // 0 if this entry holds a token.
+  };
+
+  // Indexed like the primary table, holding the one or two known tokens
+  // whose codes fit in the index bits. Decodes short codes in pairs.
+  struct FastEntry {
+    uint8_t tokens[2] = {0, 0};
+    uint8_t length = 0;  // Bits of all tokens.
+    uint8_t num_tokens = 0;  // 0 if decode_table_ must be used.
+  };
+
+  // Fills decode_table_ from nodes_.
+  void BuildDecodeTable();
+  // Fills the 2^bits entries at `offset` for the codes below `node`.
+  void FillDecodeTable(size_t node, int bits, size_t offset,
+                       const std::vector<uint32_t>& leaf_tokens);
+
+  // Reads the next code and returns its token or kEscapeEntry.
+  uint32_t DecodeToken(bitstream::BitInStreamer* in) const;
+
+  // Bit reader of one of the four streams, without bounds checks.
+  struct FourStreamReader;
+  // Decodes a long code or an Escape, refilling as needed.
+  uint8_t DecodeTokenSlow(FourStreamReader* reader) const;
+
   // Will give index of Escape token if unknown token.
   size_t IndexOfToken(unsigned char token) const;
 
@@ -73,6 +195,20 @@ class Huffman {
 
   // Map of tokens to index in nodes_ and distribution_
   std::map<unsigned char,size_t> token_map_;
+
+  // What Encode pushes for each byte, so it needs no lookups in token_map_
+  // or walks up the tree. Unknown bytes hold the Escape code followed by the
+  // byte itself.
+  std::array<CodeEntry, kEscapeEntry + 1> code_table_;
+
+  std::vector<DecodeEntry> decode_table_;
+  std::vector<FastEntry> fast_table_;
+  // Indexed like the primary table: a known token whose code fits in the
+  // index bits, plus its code length times 256. 0 if not.
+  std::vector<uint16_t> single_table_;
+  int primary_bits_ = 0;
+  // Longest code of any byte, including Escape and the byte after it.
+  int max_encoded_length_ = 0;
 };
 
 std::vector<float> EnglishLetterDistribution();
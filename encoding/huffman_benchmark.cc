@@ -0,0 +1,153 @@
+#include "huffman.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../base/benchmark.h"
+#include "huffman_frames.h"
+
+namespace huffman {
+namespace {
+class NullBuffer : public std::streambuf {
+ protected:
+  int overflow(int c) override { return c; }
+  std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+NullBuffer null_buffer;
+std::ostream null_stream(&null_buffer);
+
+const size_t kTextSize = 1 << 20;
+
+// Lower case letters drawn from the English distribution, with a space now
+// and then to exercise escaping.
+const std::string& Text() {
+  static const std::string* text = [] {
+    const std::vector<float> distribution = EnglishLetterDistribution();
+    std::string* result = new std::string();
+    uint32_t value = 12345;
+    while (result->size() < kTextSize) {
+      value = value * 1103515245 + 12345;
+      float sample = ((value >> 8) & 0xFFFF) / 65536.0f;
+      if (sample < 0.02f) {
+        result->push_back(' ');
+        continue;
+      }
+      size_t letter = 0;
+      while (letter + 1 < distribution.size() && sample >= distribution[letter]) {
+        sample -= distribution[letter];
+        ++letter;
+      }
+      result->push_back('a' + letter);
+    }
+    return result;
+  }();
+  return *text;
+}
+
+const Huffman& English() {
+  static const Huffman* huffman =
+      new Huffman(EnglishLetterDistribution(), "abcdefghijklmnopqrstuvwxyz");
+  return *huffman;
+}
+
+const std::string& EncodedText() {
+  static const std::string* encoded = [] {
+    std::istringstream input(Text());
+    std::ostringstream output;
+    English().Encode(&input, &output);
+    return new std::string(output.str());
+  }();
+  return *encoded;
+}
+}  // namespace
+
+BENCHMARK(huffman_from_distribution) {
+  Huffman huff(EnglishLetterDistribution(), "abcdefghijklmnopqrstuvwxyz");
+  benchmark::DoNotOptimize(&huff);
+  SetItemsProcessed(1, "code books");
+}
+
+BENCHMARK(huffman_load_code_book) {
+  static const std::vector<uint8_t> code_book = [] {
+    std::vector<uint8_t> result;
+    English().SerializeCodeBook(&result);
+    return result;
+  }();
+  Huffman huff(code_book.data(), code_book.size());
+  benchmark::DoNotOptimize(&huff);
+  SetItemsProcessed(1, "code books");
+}
+
+BENCHMARK(huffman_encode) {
+  std::istringstream input(Text());
+  English().Encode(&input, &null_stream);
+  SetBytesProcessed(Text().size());
+}
+
+BENCHMARK(huffman_encode_buffer) {
+  static std::vector<uint8_t> encoded;
+  encoded.clear();
+  English().Encode(reinterpret_cast<const uint8_t*>(Text().data()), Text().size(), &encoded);
+  SetBytesProcessed(Text().size());
+}
+
+BENCHMARK(huffman_decode_stream) {
+  std::istringstream input(EncodedText());
+  English().Decode(&input, &null_stream, Text().size());
+  SetBytesProcessed(Text().size());
+}
+
+BENCHMARK(huffman_decode_buffer) {
+  static std::vector<uint8_t> output(Text().size());
+  const std::string& encoded = EncodedText();
+  English().Decode(reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size(),
+                   output.size(), output.data());
+  benchmark::DoNotOptimize(output.data());
+  SetBytesProcessed(Text().size());
+}
+
+BENCHMARK(huffman_decode_four_streams) {
+  static const std::vector<uint8_t> encoded = [] {
+    std::vector<uint8_t> result;
+    English().EncodeFourStreams(reinterpret_cast<const uint8_t*>(Text().data()), Text().size(),
+                                &result);
+    return result;
+  }();
+  static std::vector<uint8_t> output(Text().size());
+  English().DecodeFourStreams(encoded.data(), encoded.size(), output.size(), output.data());
+  benchmark::DoNotOptimize(output.data());
+  SetBytesProcessed(Text().size());
+}
+
+BENCHMARK(huffman_encode_frames_1_thread) {
+  static std::vector<uint8_t> frames;
+  frames.clear();
+  EncodeFrames(English(), reinterpret_cast<const uint8_t*>(Text().data()), Text().size(),
+               1 << 16, 1, &frames);
+  SetBytesProcessed(Text().size());
+}
+
+BENCHMARK(huffman_encode_frames_4_threads) {
+  static std::vector<uint8_t> frames;
+  frames.clear();
+  EncodeFrames(English(), reinterpret_cast<const uint8_t*>(Text().data()), Text().size(),
+               1 << 16, 4, &frames);
+  SetBytesProcessed(Text().size());
+}
+
+BENCHMARK(huffman_decode_frames_4_threads) {
+  static const std::vector<uint8_t> frames = [] {
+    std::vector<uint8_t> result;
+    EncodeFrames(English(), reinterpret_cast<const uint8_t*>(Text().data()), Text().size(),
+                 1 << 16, 1, &result);
+    return result;
+  }();
+  static std::vector<uint8_t> output;
+  output.clear();
+  DecodeFrames(English(), frames.data(), frames.size(), 4, &output);
+  SetBytesProcessed(Text().size());
+}
+
+}  // namespace huffman
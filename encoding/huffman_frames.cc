@@ -0,0 +1,286 @@
+#include "huffman_frames.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "../bitwise/bitstream.h"
+
+using bitstream::BitInStreamer;
+
+namespace huffman {
+namespace {
+// A code is at most 256 bits, plus 8 for an escaped byte.
+const size_t kMaxFrameCompressedSize = 33 * kMaxFrameBlockSize;
+
+struct Frame {
+  const uint8_t* data = nullptr;
+  size_t compressed_size = 0;
+  size_t original_size = 0;
+  size_t output_offset = 0;
+};
+
+void StoreBigEndian32(uint32_t value, uint8_t* bytes) {
+  for (int i = 3; i >= 0; --i) {
+    bytes[i] = value & 0xFF;
+    value >>= 8;
+  }
+}
+
+uint32_t LoadBigEndian32(const uint8_t* bytes) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; ++i) {
+    value = (value << 8) | bytes[i];
+  }
+  return value;
+}
+
+// Returns false unless `header` holds sizes a frame can have. Every token
+// costs at least one bit, so headers cannot claim output far beyond the
+// bytes that follow them.
+bool ParseHeader(const uint8_t* header, Frame* frame) {
+  frame->compressed_size = LoadBigEndian32(header);
+  frame->original_size = LoadBigEndian32(header + 4);
+  return frame->compressed_size <= kMaxFrameCompressedSize &&
+         frame->original_size <= kMaxFrameBlockSize &&
+         frame->original_size <= 8 * frame->compressed_size;
+}
+
+// Worker threads kept for several ParallelFor calls, so the stream
+// functions start them once and not for every batch.
+class WorkerPool {
+ public:
+  // The calling thread works too, so this starts num_threads - 1 threads.
+  explicit WorkerPool(size_t num_threads) {
+    for (size_t t = 1; t < num_threads; ++t) {
+      threads_.emplace_back([this] { Work(); });
+    }
+  }
+
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    changed_.notify_all();
+    for (std::thread& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  // Runs task(i) for i in [0, count) on all threads, each taking the next i
+  // when done with the last. Returns when all are done.
+  void ParallelFor(size_t count, const std::function<void(size_t)>& task) {
+    if (threads_.empty() || count <= 1) {
+      for (size_t i = 0; i < count; ++i) {
+        task(i);
+      }
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      task_ = &task;
+      count_ = count;
+      next_ = 0;
+      busy_ = threads_.size();
+      ++generation_;
+    }
+    changed_.notify_all();
+    RunTasks(&task, count);
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this] { return busy_ == 0; });
+    task_ = nullptr;
+  }
+
+ private:
+  void RunTasks(const std::function<void(size_t)>* task, size_t count) {
+    for (size_t i = next_++; i < count; i = next_++) {
+      (*task)(i);
+    }
+  }
+
+  void Work() {
+    size_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      changed_.wait(lock, [this, seen] { return stopping_ || generation_ != seen; });
+      if (stopping_) return;
+      seen = generation_;
+      const std::function<void(size_t)>* task = task_;
+      const size_t count = count_;
+      lock.unlock();
+      RunTasks(task, count);
+      lock.lock();
+      if (--busy_ == 0) changed_.notify_all();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  std::vector<std::thread> threads_;
+  // The current loop, changed under the mutex and read by workers after
+  // they see a new generation.
+  const std::function<void(size_t)>* task_ = nullptr;
+  size_t count_ = 0;
+  std::atomic<size_t> next_{0};
+  size_t generation_ = 0;
+  // Workers still running the current loop.
+  size_t busy_ = 0;
+  bool stopping_ = false;
+};
+
+// Sets `frame` to the header and encoded bits of one block.
+void EncodeFrame(const Huffman& huff, const uint8_t* data, size_t size,
+                 std::vector<uint8_t>* frame) {
+  frame->assign(kFrameHeaderSize, 0);
+  huff.Encode(data, size, frame);
+  StoreBigEndian32(frame->size() - kFrameHeaderSize, frame->data());
+  StoreBigEndian32(size, frame->data() + 4);
+}
+
+bool DecodeFrame(const Huffman& huff, const Frame& frame, uint8_t* output) {
+  BitInStreamer in(frame.data, frame.compressed_size);
+  return huff.DecodeTokens(&in, frame.original_size, output);
+}
+
+bool IsValidBlockSize(size_t block_size) {
+  return block_size > 0 && block_size <= kMaxFrameBlockSize;
+}
+}  // namespace
+
+bool EncodeFrames(const Huffman& huff, const uint8_t* data, size_t size, size_t block_size,
+                  size_t num_threads, std::vector<uint8_t>* out) {
+  if (!huff.is_successful() || !IsValidBlockSize(block_size)) return false;
+  const size_t num_blocks = (size + block_size - 1) / block_size;
+  std::vector<std::vector<uint8_t>> frames(num_blocks);
+  WorkerPool pool(std::min(num_threads, num_blocks));
+  pool.ParallelFor(num_blocks, [&](size_t i) {
+    const size_t begin = i * block_size;
+    EncodeFrame(huff, data + begin, std::min(block_size, size - begin), &frames[i]);
+  });
+  for (const std::vector<uint8_t>& frame : frames) {
+    out->insert(out->end(), frame.begin(), frame.end());
+  }
+  return true;
+}
+
+bool DecodeFrames(const Huffman& huff, const uint8_t* data, size_t size, size_t num_threads,
+                  std::vector<uint8_t>* out) {
+  if (!huff.is_successful()) return false;
+  // Headers are read first to place each frame in the output.
+  std::vector<Frame> frames;
+  size_t output_size = out->size();
+  for (size_t offset = 0; offset < size;) {
+    Frame frame;
+    if (size - offset < kFrameHeaderSize || !ParseHeader(data + offset, &frame)) return false;
+    offset += kFrameHeaderSize;
+    if (size - offset < frame.compressed_size) return false;
+    frame.data = data + offset;
+    frame.output_offset = output_size;
+    offset += frame.compressed_size;
+    output_size += frame.original_size;
+    frames.push_back(frame);
+  }
+
+  out->resize(output_size);
+  std::atomic<bool> ok(true);
+  WorkerPool pool(std::min(num_threads, frames.size()));
+  pool.ParallelFor(frames.size(), [&](size_t i) {
+    if (!DecodeFrame(huff, frames[i], out->data() + frames[i].output_offset)) ok = false;
+  });
+  return ok;
+}
+
+size_t HeaderFrameSize(const uint8_t* header) {
+  Frame frame;
+  if (!ParseHeader(header, &frame)) return 0;
+  return kFrameHeaderSize + frame.compressed_size;
+}
+
+size_t FrameSize(const uint8_t* data, size_t size) {
+  if (size < kFrameHeaderSize) return 0;
+  const size_t frame_size = HeaderFrameSize(data);
+  return frame_size <= size ? frame_size : 0;
+}
+
+size_t CompleteFramesSize(const uint8_t* data, size_t size) {
+  size_t offset = 0;
+  for (size_t frame_size; (frame_size = FrameSize(data + offset, size - offset)) > 0;) {
+    offset += frame_size;
+  }
+  return offset;
+}
+
+bool EncodeFrames(const Huffman& huff, std::istream* input, std::ostream* output,
+                  size_t block_size, size_t num_threads) {
+  if (input == nullptr || output == nullptr) return false;
+  if (!huff.is_successful() || !IsValidBlockSize(block_size)) return false;
+  num_threads = std::max<size_t>(num_threads, 1);
+  std::vector<char> batch(num_threads * block_size);
+  std::vector<std::vector<uint8_t>> frames(num_threads);
+  WorkerPool pool(num_threads);
+  while (*input) {
+    input->read(batch.data(), batch.size());
+    const size_t size = input->gcount();
+    const size_t num_blocks = (size + block_size - 1) / block_size;
+    pool.ParallelFor(num_blocks, [&](size_t i) {
+      const size_t begin = i * block_size;
+      EncodeFrame(huff, reinterpret_cast<const uint8_t*>(batch.data()) + begin,
+                  std::min(block_size, size - begin), &frames[i]);
+    });
+    for (size_t i = 0; i < num_blocks; ++i) {
+      output->write(reinterpret_cast<const char*>(frames[i].data()), frames[i].size());
+    }
+  }
+  return bool(*output);
+}
+
+bool DecodeFrames(const Huffman& huff, std::istream* input, std::ostream* output,
+                  size_t num_threads) {
+  if (input == nullptr || output == nullptr || !huff.is_successful()) return false;
+  num_threads = std::max<size_t>(num_threads, 1);
+  std::vector<std::vector<uint8_t>> compressed(num_threads);
+  std::vector<Frame> frames(num_threads);
+  std::vector<uint8_t> decoded;
+  WorkerPool pool(num_threads);
+  bool at_end = false;
+  while (!at_end) {
+    // Reads up to one frame per thread.
+    size_t num_frames = 0;
+    size_t batch_size = 0;
+    while (num_frames < num_threads) {
+      uint8_t header[kFrameHeaderSize];
+      input->read(reinterpret_cast<char*>(header), kFrameHeaderSize);
+      if (input->gcount() == 0) {
+        at_end = true;
+        break;
+      }
+      Frame& frame = frames[num_frames];
+      if (size_t(input->gcount()) < kFrameHeaderSize || !ParseHeader(header, &frame)) {
+        return false;
+      }
+      std::vector<uint8_t>& bytes = compressed[num_frames];
+      bytes.resize(frame.compressed_size);
+      input->read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+      if (size_t(input->gcount()) < bytes.size()) return false;
+      frame.data = bytes.data();
+      frame.output_offset = batch_size;
+      batch_size += frame.original_size;
+      ++num_frames;
+    }
+
+    decoded.resize(batch_size);
+    std::atomic<bool> ok(true);
+    pool.ParallelFor(num_frames, [&](size_t i) {
+      if (!DecodeFrame(huff, frames[i], decoded.data() + frames[i].output_offset)) ok = false;
+    });
+    if (!ok) return false;
+    output->write(reinterpret_cast<const char*>(decoded.data()), decoded.size());
+  }
+  return bool(*output);
+}
+
+}  // namespace huffman
@@ -0,0 +1,67 @@
+// Block-parallel Huffman coding in independent frames.
+//
+// The input is split into blocks of `block_size` bytes, and each block is
+// encoded on its own into a byte-aligned frame. Frames do not depend on
+// each other, so they are encoded and decoded concurrently, one frame per
+// task, and written in order.
+//
+// Frame layout, integers 32-bit big-endian:
+// [compressed size][original size][encoded bits, padded to a byte]
+//
+// Example:
+// std::vector<uint8_t> frames;
+// EncodeFrames(huff, data, size, 1 << 20, 4, &frames);
+// std::vector<uint8_t> decoded;
+// DecodeFrames(huff, frames.data(), frames.size(), 4, &decoded);
+
+#ifndef HUFFMAN_FRAMES_H
+#define HUFFMAN_FRAMES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "huffman.h"
+
+namespace huffman {
+
+const size_t kFrameHeaderSize = 8;
+// Largest block, so that even a block of escaped bytes fits in a frame.
+const size_t kMaxFrameBlockSize = 1 << 24;
+
+// Appends the frames of the `size` bytes at `data` to `out`, using up to
+// `num_threads` threads. Returns false if `huff` is not successful or
+// `block_size` is 0 or above kMaxFrameBlockSize.
+bool EncodeFrames(const Huffman& huff, const uint8_t* data, size_t size, size_t block_size,
+                  size_t num_threads, std::vector<uint8_t>* out);
+// Appends the decoded frames at `data` to `out`.
+// Returns false if a frame is truncated or does not decode.
+bool DecodeFrames(const Huffman& huff, const uint8_t* data, size_t size, size_t num_threads,
+                  std::vector<uint8_t>* out);
+
+// Same, from stream to stream. Reads and encodes a batch of blocks for all
+// threads at a time, so memory stays within a few blocks per thread. The
+// threads are started once per call and reused for every batch.
+bool EncodeFrames(const Huffman& huff, std::istream* input, std::ostream* output,
+                  size_t block_size, size_t num_threads);
+bool DecodeFrames(const Huffman& huff, std::istream* input, std::ostream* output,
+                  size_t num_threads);
+
+// Returns the size of the frame starting with the kFrameHeaderSize bytes at
+// `header`, header included, or 0 if no frame can have that header, so no
+// more input can complete the frame.
+size_t HeaderFrameSize(const uint8_t* header);
+
+// Returns the size of the frame at the start of `data`, header included, or
+// 0 if it is truncated or its header is invalid.
+size_t FrameSize(const uint8_t* data, size_t size);
+
+// Returns the size of the whole frames at the start of `data`, so a reader
+// can decode them while the rest of the input is still arriving. Stops at
+// the first truncated frame or invalid header.
+size_t CompleteFramesSize(const uint8_t* data, size_t size);
+
+}  // namespace huffman
+
+#endif
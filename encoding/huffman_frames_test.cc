@@ -0,0 +1,126 @@
+#include "huffman_frames.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../base/testing.h"
+
+namespace huffman {
+namespace {
+std::vector<uint8_t> Text(size_t size) {
+  std::vector<uint8_t> result;
+  for (size_t i = 0; i < size; ++i) {
+    result.push_back(i % 97 == 0 ? ' ' : 'a' + (i * i) % 26);
+  }
+  return result;
+}
+
+const Huffman& English() {
+  static const Huffman* huffman =
+      new Huffman(EnglishLetterDistribution(), "abcdefghijklmnopqrstuvwxyz");
+  return *huffman;
+}
+}  // namespace
+
+TEST(frames_round_trip) {
+  const std::vector<uint8_t> text = Text(100000);
+  for (size_t block_size : {1, 1000, 4096, 100000, 1 << 20}) {
+    for (size_t num_threads : {1, 3}) {
+      std::vector<uint8_t> frames;
+      ASSERT_TRUE(
+          EncodeFrames(English(), text.data(), text.size(), block_size, num_threads, &frames));
+      std::vector<uint8_t> decoded;
+      ASSERT_TRUE(DecodeFrames(English(), frames.data(), frames.size(), num_threads, &decoded));
+      ASSERT_TRUE(decoded == text);
+    }
+  }
+}
+
+TEST(frames_layout) {
+  const std::vector<uint8_t> text = Text(2500);
+  std::vector<uint8_t> frames;
+  ASSERT_TRUE(EncodeFrames(English(), text.data(), text.size(), 1000, 2, &frames));
+
+  // Three frames, the last with 500 bytes.
+  size_t offset = 0;
+  std::vector<size_t> original_sizes;
+  while (offset < frames.size()) {
+    const uint8_t* header = frames.data() + offset;
+    const size_t compressed = (header[0] << 24) | (header[1] << 16) | (header[2] << 8) | header[3];
+    original_sizes.push_back((header[4] << 24) | (header[5] << 16) | (header[6] << 8) | header[7]);
+    offset += kFrameHeaderSize + compressed;
+  }
+  ASSERT_EQ(frames.size(), offset);
+  ASSERT_TRUE(original_sizes == std::vector<size_t>({1000, 1000, 500}));
+
+  // Each frame decodes alone.
+  std::vector<uint8_t> decoded;
+  const size_t first_size = kFrameHeaderSize + (frames[2] << 8) + frames[3];
+  ASSERT_EQ(first_size, CompleteFramesSize(frames.data(), first_size + kFrameHeaderSize + 1));
+  ASSERT_EQ(frames.size(), CompleteFramesSize(frames.data(), frames.size()));
+  ASSERT_EQ(0, CompleteFramesSize(frames.data(), 5));
+  ASSERT_EQ(first_size, FrameSize(frames.data(), frames.size()));
+  ASSERT_EQ(0, FrameSize(frames.data(), first_size - 1));
+  ASSERT_TRUE(DecodeFrames(English(), frames.data(), first_size, 1, &decoded));
+  ASSERT_TRUE(decoded == std::vector<uint8_t>(text.begin(), text.begin() + 1000));
+}
+
+TEST(frames_empty_and_invalid) {
+  std::vector<uint8_t> frames;
+  ASSERT_TRUE(EncodeFrames(English(), nullptr, 0, 1000, 2, &frames));
+  ASSERT_EMPTY(frames);
+  ASSERT_FALSE(EncodeFrames(English(), nullptr, 0, 0, 2, &frames));
+  ASSERT_FALSE(EncodeFrames(English(), nullptr, 0, kMaxFrameBlockSize + 1, 2, &frames));
+
+  const std::vector<uint8_t> text = Text(5000);
+  ASSERT_TRUE(EncodeFrames(English(), text.data(), text.size(), 1000, 2, &frames));
+  std::vector<uint8_t> decoded;
+  ASSERT_FALSE(DecodeFrames(English(), frames.data(), frames.size() - 1, 2, &decoded));
+  ASSERT_FALSE(DecodeFrames(English(), frames.data(), 5, 2, &decoded));
+  ASSERT_EQ(FrameSize(frames.data(), frames.size()), HeaderFrameSize(frames.data()));
+  // A frame claiming more bytes than its bits hold.
+  frames[6] += 1;
+  ASSERT_FALSE(DecodeFrames(English(), frames.data(), frames.size(), 2, &decoded));
+  // A block larger than kMaxFrameBlockSize.
+  frames[4] = 0xFF;
+  ASSERT_EQ(0, HeaderFrameSize(frames.data()));
+
+  // Headers claiming large blocks with empty payloads, which must fail
+  // before the claimed output is allocated.
+  std::vector<uint8_t> empty_frames;
+  for (size_t i = 0; i < 1000; ++i) {
+    const uint8_t header[kFrameHeaderSize] = {0, 0, 0, 0, 1, 0, 0, 0};
+    empty_frames.insert(empty_frames.end(), header, header + kFrameHeaderSize);
+  }
+  ASSERT_EQ(0, HeaderFrameSize(empty_frames.data()));
+  ASSERT_EQ(0, FrameSize(empty_frames.data(), empty_frames.size()));
+  decoded.clear();
+  ASSERT_FALSE(DecodeFrames(English(), empty_frames.data(), empty_frames.size(), 2, &decoded));
+  ASSERT_EMPTY(decoded);
+}
+
+TEST(frames_stream) {
+  const std::vector<uint8_t> text = Text(123457);
+  for (size_t num_threads : {1, 4}) {
+    std::istringstream input(std::string(text.begin(), text.end()));
+    std::ostringstream encoded;
+    ASSERT_TRUE(EncodeFrames(English(), &input, &encoded, 10000, num_threads));
+
+    // Same bytes as in memory.
+    std::vector<uint8_t> frames;
+    EncodeFrames(English(), text.data(), text.size(), 10000, 1, &frames);
+    ASSERT_EQ(std::string(frames.begin(), frames.end()), encoded.str());
+
+    std::istringstream encoded_input(encoded.str());
+    std::ostringstream decoded;
+    ASSERT_TRUE(DecodeFrames(English(), &encoded_input, &decoded, num_threads));
+    ASSERT_EQ(std::string(text.begin(), text.end()), decoded.str());
+
+    std::istringstream truncated(encoded.str().substr(0, encoded.str().size() - 3));
+    std::ostringstream ignored;
+    ASSERT_FALSE(DecodeFrames(English(), &truncated, &ignored, num_threads));
+  }
+}
+
+}  // namespace huffman
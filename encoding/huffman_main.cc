@@ -0,0 +1,313 @@
+// Command line tool for Huffman coding in shell pipelines.
+//
+// huffman train [input] > code_book
+//   Counts the bytes of the input and writes a code book of codes at most
+//   kMaxCodeBookLength bits long.
+// huffman encode code_book [input] > encoded
+// huffman decode code_book [input] > decoded
+//   Encodes or decodes in frames, see huffman_frames.h, on all cores.
+//
+// Input is stdin if missing or "-". Regular files are mapped into memory,
+// anything else is read in large blocks, so no byte goes through iostream.
+// Throughput is reported on stderr.
+//
+// Options, before the command:
+// --threads=N      Threads to use, all cores by default.
+// --block_size=N   Bytes per frame when encoding, 1MB by default.
+// --quiet          Do not report throughput.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "histogram.h"
+#include "huffman.h"
+#include "huffman_frames.h"
+
+namespace huffman {
+namespace {
+// Input handed out at a time, a whole number of default blocks.
+const size_t kSliceSize = 1 << 26;
+
+struct Options {
+  size_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+  size_t block_size = 1 << 20;
+  bool quiet = false;
+};
+
+// Regular files are mapped, others read in slices into a buffer.
+class Input {
+ public:
+  ~Input() {
+    if (mapped_ != nullptr) munmap(mapped_, mapped_size_);
+    if (fd_ > STDIN_FILENO) close(fd_);
+  }
+
+  // Opens `path`, or stdin for "-". Returns false on failure.
+  bool Open(const std::string& path) {
+    fd_ = path == "-" ? STDIN_FILENO : open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+      perror(path.c_str());
+      return false;
+    }
+    struct stat info;
+    if (fstat(fd_, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+      void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd_, 0);
+      if (mapped != MAP_FAILED) {
+        mapped_ = static_cast<uint8_t*>(mapped);
+        mapped_size_ = info.st_size;
+        madvise(mapped_, mapped_size_, MADV_SEQUENTIAL);
+        return true;
+      }
+    }
+    buffer_.resize(kSliceSize);
+    return true;
+  }
+
+  // Sets `data` and `size` to the next slice of at most `max_size` bytes, or
+  // kSliceSize if 0. Slices are only shorter at the end of the input.
+  // Returns false at the end or on failure, see ok().
+  bool Next(const uint8_t** data, size_t* size, size_t max_size = 0) {
+    if (max_size == 0) max_size = kSliceSize;
+    if (mapped_ != nullptr) {
+      *data = mapped_ + offset_;
+      *size = std::min(max_size, mapped_size_ - offset_);
+      offset_ += *size;
+      return *size > 0;
+    }
+    if (buffer_.size() < max_size) buffer_.resize(max_size);
+    *data = buffer_.data();
+    *size = 0;
+    while (*size < max_size) {
+      const ssize_t count = read(fd_, buffer_.data() + *size, max_size - *size);
+      if (count < 0) {
+        failed_ = true;
+        return false;
+      }
+      if (count == 0) break;
+      *size += count;
+    }
+    return *size > 0;
+  }
+
+  bool ok() const { return !failed_; }
+
+ private:
+  int fd_ = -1;
+  uint8_t* mapped_ = nullptr;
+  size_t mapped_size_ = 0;
+  size_t offset_ = 0;
+  std::vector<uint8_t> buffer_;
+  bool failed_ = false;
+};
+
+bool WriteAll(const uint8_t* data, size_t size) {
+  while (size > 0) {
+    const ssize_t count = write(STDOUT_FILENO, data, size);
+    if (count <= 0) return false;
+    data += count;
+    size -= count;
+  }
+  return true;
+}
+
+typedef std::chrono::steady_clock Clock;
+
+void ReportThroughput(const Options& options, const char* command, size_t input_size,
+                      size_t output_size, Clock::time_point start) {
+  if (options.quiet) return;
+  const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  // Measured on the uncompressed side.
+  const size_t plain_size = std::max(input_size, output_size);
+  fprintf(stderr, "%s: %zu bytes -> %zu bytes in %.3f s, %.1f MB/s\n", command, input_size,
+          output_size, seconds, seconds > 0 ? plain_size / seconds / 1e6 : 0.0);
+}
+
+int Train(const Options& options, Input* input) {
+  const Clock::time_point start = Clock::now();
+  ByteCounts counts{};
+  size_t input_size = 0;
+  const uint8_t* data;
+  size_t size;
+  while (input->Next(&data, &size)) {
+    AddCounts(CountBytes(data, size, options.num_threads), &counts);
+    input_size += size;
+  }
+  if (!input->ok()) return 1;
+
+  std::vector<float> distribution;
+  std::vector<unsigned char> tokens;
+  NormalizeCounts(counts, &distribution, &tokens);
+  const Huffman huff(distribution, tokens, Huffman::kMaxCodeBookLength);
+  std::vector<uint8_t> code_book;
+  if (!huff.SerializeCodeBook(&code_book) || !WriteAll(code_book.data(), code_book.size())) {
+    return 1;
+  }
+  ReportThroughput(options, "train", input_size, code_book.size(), start);
+  return 0;
+}
+
+int Encode(const Options& options, const Huffman& huff, Input* input) {
+  const Clock::time_point start = Clock::now();
+  // Slices of whole blocks, so each frame but the last is full.
+  const size_t slice_size = std::max<size_t>(1, kSliceSize / options.block_size) *
+                            options.block_size;
+  size_t input_size = 0;
+  size_t output_size = 0;
+  std::vector<uint8_t> frames;
+  const uint8_t* data;
+  size_t size;
+  while (input->Next(&data, &size, slice_size)) {
+    frames.clear();
+    if (!EncodeFrames(huff, data, size, options.block_size, options.num_threads, &frames) ||
+        !WriteAll(frames.data(), frames.size())) {
+      return 1;
+    }
+    input_size += size;
+    output_size += frames.size();
+  }
+  if (!input->ok()) return 1;
+  ReportThroughput(options, "encode", input_size, output_size, start);
+  return 0;
+}
+
+int Decode(const Options& options, const Huffman& huff, Input* input) {
+  const Clock::time_point start = Clock::now();
+  size_t input_size = 0;
+  size_t output_size = 0;
+  std::vector<uint8_t> decoded;
+  auto decode_frames = [&](const uint8_t* data, size_t size) {
+    decoded.clear();
+    if (!DecodeFrames(huff, data, size, options.num_threads, &decoded) ||
+        !WriteAll(decoded.data(), decoded.size())) {
+      return false;
+    }
+    output_size += decoded.size();
+    return true;
+  };
+  auto invalid_header = [&input_size](size_t remaining) {
+    fprintf(stderr, "Invalid frame header at input byte %zu\n", input_size - remaining);
+    return 1;
+  };
+
+  // Start of a frame that continues in the next slice.
+  std::vector<uint8_t> pending;
+  const uint8_t* data;
+  size_t size;
+  while (input->Next(&data, &size)) {
+    input_size += size;
+    if (!pending.empty()) {
+      // Copies only the bytes that finish the split frame, header first.
+      auto take = [&pending, &data, &size](size_t count) {
+        count = std::min(count, size);
+        pending.insert(pending.end(), data, data + count);
+        data += count;
+        size -= count;
+      };
+      if (pending.size() < kFrameHeaderSize) take(kFrameHeaderSize - pending.size());
+      if (pending.size() < kFrameHeaderSize) continue;
+      const size_t frame_size = HeaderFrameSize(pending.data());
+      if (frame_size == 0) return invalid_header(size + pending.size());
+      take(frame_size - pending.size());
+      if (pending.size() < frame_size) continue;
+      if (!decode_frames(pending.data(), pending.size())) return 1;
+      pending.clear();
+    }
+
+    // Whole frames decode straight from the slice.
+    const size_t complete = CompleteFramesSize(data, size);
+    if (!decode_frames(data, complete)) return 1;
+    // Fails before buffering the rest of the input behind a bad header.
+    if (size - complete >= kFrameHeaderSize && HeaderFrameSize(data + complete) == 0) {
+      return invalid_header(size - complete);
+    }
+    pending.assign(data + complete, data + size);
+  }
+  if (!input->ok()) return 1;
+  if (!pending.empty()) {
+    fprintf(stderr, "Truncated frame at input byte %zu\n", input_size - pending.size());
+    return 1;
+  }
+  ReportThroughput(options, "decode", input_size, output_size, start);
+  return 0;
+}
+
+// Parses "--name=value" into `value` if `arg` starts with "--name=".
+bool ParseSizeFlag(const char* arg, const char* name, size_t* value) {
+  const std::string prefix = std::string("--") + name + "=";
+  if (strncmp(arg, prefix.c_str(), prefix.size()) != 0) return false;
+  *value = strtoull(arg + prefix.size(), nullptr, 10);
+  return true;
+}
+
+int Usage() {
+  fprintf(stderr,
+          "Usage: huffman [--threads=N] [--block_size=N] [--quiet] <command>\n"
+          "  train [input] > code_book\n"
+          "  encode code_book [input] > encoded\n"
+          "  decode code_book [input] > decoded\n");
+  return 2;
+}
+
+int Main(int argc, char** argv) {
+  Options options;
+  int arg = 1;
+  for (; arg < argc && strncmp(argv[arg], "--", 2) == 0; ++arg) {
+    if (strcmp(argv[arg], "--quiet") == 0) {
+      options.quiet = true;
+    } else if (!ParseSizeFlag(argv[arg], "threads", &options.num_threads) &&
+               !ParseSizeFlag(argv[arg], "block_size", &options.block_size)) {
+      return Usage();
+    }
+  }
+  if (arg == argc) return Usage();
+  const std::string command = argv[arg++];
+  options.num_threads = std::max<size_t>(options.num_threads, 1);
+  if (options.block_size == 0 || options.block_size > kMaxFrameBlockSize) {
+    fprintf(stderr, "--block_size must be between 1 and %zu\n", kMaxFrameBlockSize);
+    return 2;
+  }
+
+  if (command == "train") {
+    if (argc - arg > 1) return Usage();
+    Input input;
+    if (!input.Open(arg < argc ? argv[arg] : "-")) return 1;
+    return Train(options, &input);
+  }
+  if (command != "encode" && command != "decode") return Usage();
+  if (arg == argc || argc - arg > 2) return Usage();
+
+  Input code_book_input;
+  std::vector<uint8_t> code_book;
+  if (!code_book_input.Open(argv[arg++])) return 1;
+  const uint8_t* data;
+  size_t size;
+  while (code_book_input.Next(&data, &size)) {
+    code_book.insert(code_book.end(), data, data + size);
+  }
+  const Huffman huff(code_book.data(), code_book.size());
+  if (!huff.is_successful()) {
+    fprintf(stderr, "Invalid code book\n");
+    return 1;
+  }
+
+  Input input;
+  if (!input.Open(arg < argc ? argv[arg] : "-")) return 1;
+  return command == "encode" ? Encode(options, huff, &input) : Decode(options, huff, &input);
+}
+}  // namespace
+}  // namespace huffman
+
+int main(int argc, char** argv) {
+  return huffman::Main(argc, argv);
+}
@@ -1,8 +1,10 @@
 
 #include "huffman.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <sstream>
+#include <vector>
 
 #include "../base/container_utils.h"
 #include "../base/testing.h"
@@ -37,6 +39,43 @@ std::string ProduceEquivalent(const Huffman& huff, const std::string& plaintext)
   return string_stream.str();
 }
 
+// Encodes and decodes through streams and through memory.
+// Returns the stream decoding if both match.
+std::string RoundTrip(const Huffman& huff, const std::string& plaintext) {
+  is_stream input(plaintext);
+  os_stream encoded;
+  huff.Encode(&input, &encoded);
+
+  is_stream encoded_input(encoded.str());
+  os_stream decoded;
+  if (!huff.Decode(&encoded_input, &decoded, plaintext.size())) return "Decode failed";
+
+  const std::string bytes = encoded.str();
+  std::vector<uint8_t> buffer_decoded(plaintext.size());
+  if (!huff.Decode(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size(),
+                   plaintext.size(), buffer_decoded.data())) {
+    return "Buffer decode failed";
+  }
+  if (std::string(buffer_decoded.begin(), buffer_decoded.end()) != decoded.str()) {
+    return "Buffer decode differs";
+  }
+
+  const uint8_t* plain = reinterpret_cast<const uint8_t*>(plaintext.data());
+  std::vector<uint8_t> memory_encoded;
+  huff.Encode(plain, plaintext.size(), &memory_encoded);
+  if (std::string(memory_encoded.begin(), memory_encoded.end()) != bytes) {
+    return "Memory encode differs";
+  }
+  if (bytes.size() > huff.MaxCompressedSize(plaintext.size())) return "Above MaxCompressedSize";
+  std::vector<uint8_t> memory_decoded;
+  if (!huff.Decode(memory_encoded.data(), memory_encoded.size(), plaintext.size(),
+                   &memory_decoded) ||
+      memory_decoded != buffer_decoded) {
+    return "Memory decode differs";
+  }
+  return decoded.str();
+}
+
 void PrintHex(const std::string& raw) {
   for (unsigned char c : raw) {
     printf("%x ", c);
@@ -90,5 +129,217 @@ TEST(huffman_encode_escaping) {
   ASSERT_EQ(expected, output.str());
 }
 
-}  // namespace huffman
+TEST(huffman_encode_long_codes) {
+  // Halving weights give a code one bit longer per token, so the last tokens
+  // and the Escape code are longer than 64 bits.
+  std::vector<float> distribution;
+  std::string tokens;
+  float weight = 1.0f;
+  for (int i = 0; i < 80; ++i) {
+    distribution.push_back(weight);
+    tokens.push_back(' ' + i);
+    weight /= 2;
+  }
+  const Huffman huff(distribution, tokens);
+  ASSERT_TRUE(huff.is_successful());
+  ASSERT_GT(huff.EscapeCode().size(), 64);
+
+  std::string input_str = tokens + "\n" + tokens;
+  std::reverse(input_str.begin(), input_str.end());
+  is_stream input(input_str);
+  os_stream output;
+  huff.Encode(&input, &output);
+  ASSERT_EQ(ProduceEquivalent(huff, input_str), output.str());
+}
+
+TEST(huffman_encode_large_input) {
+  const Huffman huff(EnglishLetterDistribution(), "abcdefghijklmnopqrstuvwxyz");
+  std::string input_str;
+  for (size_t i = 0; i < 200000; ++i) {
+    input_str.push_back(i % 97 == 0 ? ' ' : 'a' + (i * i) % 26);
+  }
+  is_stream input(input_str);
+  os_stream output;
+  huff.Encode(&input, &output);
+  ASSERT_EQ(ProduceEquivalent(huff, input_str), output.str());
+}
+
+TEST(huffman_decode_simple) {
+  const Huffman huff({0.5, 0.1, 0.3, 0.4}, "abcd");
+  for (const std::string text : {"", "a", "aaaa", "bbbacddc", "dddddddddddddddddb"}) {
+    ASSERT_EQ(text, RoundTrip(huff, text));
+  }
+}
+
+TEST(huffman_decode_escaping) {
+  const Huffman huff({0.5, 0.1, 0.3, 0.4}, "abcd");
+  std::string text = "bb b a cddc.";
+  for (int c = 0; c < 256; ++c) {
+    text.push_back(c);
+  }
+  ASSERT_EQ(text, RoundTrip(huff, text));
+
+  // Only escaped tokens.
+  const Huffman empty({}, "");
+  ASSERT_EQ(text, RoundTrip(empty, text));
+}
+
+TEST(huffman_decode_long_codes) {
+  // Codes up to 80 bits need several levels of decoding tables.
+  std::vector<float> distribution;
+  std::string tokens;
+  float weight = 1.0f;
+  for (int i = 0; i < 80; ++i) {
+    distribution.push_back(weight);
+    tokens.push_back(' ' + i);
+    weight /= 2;
+  }
+  const Huffman huff(distribution, tokens);
+  const std::string text = tokens + "\n\t" + tokens + tokens;
+  ASSERT_EQ(text, RoundTrip(huff, text));
+}
 
+TEST(huffman_decode_large) {
+  const Huffman huff(EnglishLetterDistribution(), "abcdefghijklmnopqrstuvwxyz");
+  std::string text;
+  for (size_t i = 0; i < 300000; ++i) {
+    text.push_back(i % 97 == 0 ? ' ' : 'a' + (i * i) % 26);
+  }
+  ASSERT_EQ(text, RoundTrip(huff, text));
+}
+
+TEST(huffman_encode_memory) {
+  const Huffman huff({0.5, 0.1, 0.3, 0.4}, "abcd");
+  // Escaped bytes take the longest code, Escape and then 8 bits.
+  ASSERT_EQ(0u, huff.MaxCompressedSize(0));
+  ASSERT_EQ(huff.EscapeCode().size() + 8, huff.MaxCompressedSize(8));
+
+  const std::string text = "abcd.dcba";
+  const uint8_t* plain = reinterpret_cast<const uint8_t*>(text.data());
+  std::vector<uint8_t> appended = {0xAB};
+  huff.Encode(plain, text.size(), &appended);
+  ASSERT_EQ(0xAB, appended[0]);
+  const std::string expected = ProduceEquivalent(huff, text);
+  ASSERT_EQ(expected, std::string(appended.begin() + 1, appended.end()));
+
+  std::vector<uint8_t> preallocated(huff.MaxCompressedSize(text.size()));
+  ASSERT_EQ(expected.size(), huff.Encode(plain, text.size(), preallocated.data()));
+  ASSERT_EQ(expected, std::string(preallocated.begin(), preallocated.begin() + expected.size()));
+
+  std::vector<uint8_t> decoded = {'>'};
+  ASSERT_TRUE(huff.Decode(appended.data() + 1, appended.size() - 1, text.size(), &decoded));
+  ASSERT_EQ(">" + text, std::string(decoded.begin(), decoded.end()));
+  ASSERT_FALSE(huff.Decode(appended.data() + 1, 1, text.size(), &decoded));
+  ASSERT_EQ(1 + text.size(), decoded.size());
+}
+
+TEST(huffman_decode_truncated) {
+  const Huffman huff(EnglishLetterDistribution(), "abcdefghijklmnopqrstuvwxyz");
+  const std::string text = "the quick brown fox jumps over the lazy dog";
+  is_stream input(text);
+  os_stream encoded;
+  huff.Encode(&input, &encoded);
+  const std::string bytes = encoded.str();
+
+  std::vector<uint8_t> decoded(text.size());
+  ASSERT_TRUE(huff.Decode(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size(),
+                          text.size(), decoded.data()));
+  ASSERT_FALSE(huff.Decode(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size() - 2,
+                           text.size(), decoded.data()));
+  is_stream truncated(bytes.substr(0, bytes.size() / 2));
+  os_stream output;
+  ASSERT_FALSE(huff.Decode(&truncated, &output, text.size()));
+}
+
+TEST(huffman_decode_length_limited) {
+  std::vector<float> distribution;
+  std::string tokens;
+  float weight = 1.0f;
+  for (int i = 0; i < 80; ++i) {
+    distribution.push_back(weight);
+    tokens.push_back(' ' + i);
+    weight /= 2;
+  }
+  const Huffman huff(distribution, tokens, Huffman::kDecodeTableBits);
+  ASSERT_TRUE(huff.is_successful());
+  ASSERT_LE(huff.EscapeCode().size(), Huffman::kDecodeTableBits);
+  const std::string text = tokens + "\n\t" + tokens + tokens;
+  ASSERT_EQ(text, RoundTrip(huff, text));
+}
+
+std::string RoundTripFourStreams(const Huffman& huff, const std::string& plaintext) {
+  std::vector<uint8_t> encoded;
+  huff.EncodeFourStreams(reinterpret_cast<const uint8_t*>(plaintext.data()), plaintext.size(),
+                         &encoded);
+  std::string decoded(plaintext.size(), '\0');
+  if (!huff.DecodeFourStreams(encoded.data(), encoded.size(), plaintext.size(),
+                              reinterpret_cast<uint8_t*>(&decoded[0]))) {
+    return "Decode failed";
+  }
+  return decoded;
+}
+
+TEST(huffman_four_streams) {
+  const Huffman huff(EnglishLetterDistribution(), "abcdefghijklmnopqrstuvwxyz");
+  std::string text;
+  for (size_t i = 0; i < 100000; ++i) {
+    text.push_back(i % 97 == 0 ? ' ' : 'a' + (i * i) % 26);
+  }
+  // Segments of every size, including empty ones.
+  for (size_t size : {0, 1, 2, 3, 4, 5, 7, 100, 223, 1000, 100000}) {
+    const std::string prefix = text.substr(0, size);
+    ASSERT_EQ(prefix, RoundTripFourStreams(huff, prefix));
+  }
+
+  const Huffman few({0.5, 0.1, 0.3, 0.4}, "abcd");
+  ASSERT_EQ(text, RoundTripFourStreams(few, text));
+  // Only escaped tokens.
+  const Huffman empty({}, "");
+  ASSERT_EQ(text, RoundTripFourStreams(empty, text));
+}
+
+TEST(huffman_four_streams_layout) {
+  const Huffman huff({0.5, 0.1, 0.3, 0.4}, "abcd");
+  const std::string text(4000, 'a');
+  std::vector<uint8_t> encoded = {42};
+  huff.EncodeFourStreams(reinterpret_cast<const uint8_t*>(text.data()), text.size(), &encoded);
+  // Appended after the existing byte, with four streams of the same size.
+  ASSERT_EQ(42, encoded[0]);
+  const size_t stream_size = (1000 * huff.Code('a').size() + 7) / 8;
+  ASSERT_EQ(1 + Huffman::kJumpTableSize + 4 * stream_size, encoded.size());
+  // Each size in the jump table is 32-bit big-endian.
+  for (size_t s = 0; s < 3; ++s) {
+    const uint8_t* bytes = &encoded[1 + 4 * s];
+    const size_t size = (size_t(bytes[0]) << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+    ASSERT_EQ(stream_size, size);
+  }
+
+  std::string decoded(text.size(), '\0');
+  uint8_t* output = reinterpret_cast<uint8_t*>(&decoded[0]);
+  ASSERT_TRUE(huff.DecodeFourStreams(encoded.data() + 1, encoded.size() - 1, 4000, output));
+  ASSERT_EQ(text, decoded);
+  ASSERT_FALSE(huff.DecodeFourStreams(encoded.data() + 1, encoded.size() - 2, 4000, output));
+  ASSERT_FALSE(huff.DecodeFourStreams(encoded.data() + 1, 11, 0, output));
+  // A jump table pointing past the end.
+  encoded[1] = 1;
+  ASSERT_FALSE(huff.DecodeFourStreams(encoded.data() + 1, encoded.size() - 1, 4000, output));
+}
+
+TEST(huffman_four_streams_long_codes) {
+  std::vector<float> distribution;
+  std::string tokens;
+  float weight = 1.0f;
+  for (int i = 0; i < 80; ++i) {
+    distribution.push_back(weight);
+    tokens.push_back(' ' + i);
+    weight /= 2;
+  }
+  const Huffman huff(distribution, tokens);
+  std::string text;
+  for (int i = 0; i < 20; ++i) {
+    text += tokens + "\n\t" + std::string(200, ' ');
+  }
+  ASSERT_EQ(text, RoundTripFourStreams(huff, text));
+}
+
+}  // namespace huffman
@@ -1,7 +1,9 @@
 
 #include "huffman.h"
 
+#include <algorithm>
 #include <set>
+#include <vector>
 
 #include "../base/container_utils.h"
 #include "../base/testing.h"
@@ -206,4 +208,183 @@ TEST(huffman_print_english) {
   PrintCodes(huff, tokens, distr);
 }
 
+TEST(huffman_canonical_codes) {
+  const std::string tokens = "abcdefghijklmnopqrstuvwxyz";
+  Huffman huff(EnglishLetterDistribution(), tokens);
+  ASSERT_TRUE(huff.is_successful());
+
+  // Sorted by length then token, the codes count up in binary.
+  std::vector<std::pair<size_t, unsigned char>> by_length;
+  for (unsigned char token : tokens) {
+    by_length.emplace_back(huff.Code(token).size(), token);
+  }
+  std::sort(by_length.begin(), by_length.end());
+  std::string previous;
+  for (const auto& length_and_token : by_length) {
+    const std::string code = huff.Code(length_and_token.second);
+    ASSERT_LT(previous, code);
+    previous = code;
+  }
+  // The Escape code is the longest, so all ones.
+  ASSERT_EQ(std::string(huff.EscapeCode().size(), '1'), huff.EscapeCode());
+}
+
+TEST(huffman_code_book) {
+  const std::string tokens = "etaoinshrdlu";
+  Huffman huff({12.7, 9.1, 8.2, 7.5, 7.0, 6.7, 6.3, 6.1, 6.0, 4.3, 4.0, 2.8}, tokens);
+  std::vector<uint8_t> code_book;
+  ASSERT_TRUE(huff.SerializeCodeBook(&code_book));
+  ASSERT_EQ(Huffman::kCodeBookSize, code_book.size());
+
+  Huffman loaded(code_book.data(), code_book.size());
+  ASSERT_TRUE(loaded.is_successful());
+  ASSERT_EQ(huff.VocabularySize(), loaded.VocabularySize());
+  ASSERT_EQ(huff.EscapeCode(), loaded.EscapeCode());
+  for (int token = 0; token < 256; ++token) {
+    ASSERT_EQ(huff.Encoded(token), loaded.Encoded(token));
+  }
+
+  std::vector<uint8_t> again;
+  ASSERT_TRUE(loaded.SerializeCodeBook(&again));
+  ASSERT_TRUE(code_book == again);
+}
+
+TEST(huffman_empty_code_book) {
+  Huffman huff({}, "");
+  std::vector<uint8_t> code_book;
+  ASSERT_TRUE(huff.SerializeCodeBook(&code_book));
+  Huffman loaded(code_book.data(), code_book.size());
+  ASSERT_TRUE(loaded.is_successful());
+  ASSERT_EQ(0, loaded.VocabularySize());
+  ASSERT_EMPTY(loaded.EscapeCode());
+}
+
+TEST(huffman_invalid_code_book) {
+  std::vector<uint8_t> code_book(Huffman::kCodeBookSize, 0);
+  ASSERT_FALSE(Huffman(code_book.data(), code_book.size() - 1).is_successful());
+  // Lengths 1, 1 and Escape 1 do not form a prefix code.
+  code_book['a' / 2] = 0x11;
+  code_book.back() = 1;
+  ASSERT_FALSE(Huffman(code_book.data(), code_book.size()).is_successful());
+  // Lengths 1, 2 and Escape 3 leave a code unused.
+  code_book['a' / 2] = 0x12;
+  code_book.back() = 3;
+  ASSERT_FALSE(Huffman(code_book.data(), code_book.size()).is_successful());
+  // Lengths 1, 2 and Escape 2 do.
+  code_book.back() = 2;
+  ASSERT_TRUE(Huffman(code_book.data(), code_book.size()).is_successful());
+
+  // Repeated tokens cannot be written.
+  Huffman repeated({0.5, 0.5}, "aa");
+  ASSERT_FALSE(repeated.SerializeCodeBook(&code_book));
+}
+
+namespace {
+// Fibonacci weights give the longest possible codes.
+std::vector<float> FibonacciDistribution(size_t size) {
+  std::vector<float> distribution = {1, 1};
+  while (distribution.size() < size) {
+    distribution.push_back(distribution.back() + distribution[distribution.size() - 2]);
+  }
+  return distribution;
+}
+
+std::vector<std::string> AllCodes(const Huffman& huff, const std::string& tokens) {
+  std::vector<std::string> codes = {huff.EscapeCode()};
+  for (unsigned char token : tokens) {
+    codes.push_back(huff.Code(token));
+  }
+  return codes;
+}
+
+size_t LongestCode(const std::vector<std::string>& codes) {
+  size_t longest = 0;
+  for (const std::string& code : codes) {
+    longest = std::max(longest, code.size());
+  }
+  return longest;
+}
+}  // namespace
+
+TEST(huffman_length_limited) {
+  const std::vector<float> distr = FibonacciDistribution(30);
+  const std::string tokens = "abcdefghijklmnopqrstuvwxyz0123";
+  const Huffman unlimited(distr, tokens);
+  ASSERT_EQ(30, LongestCode(AllCodes(unlimited, tokens)));
+  std::vector<uint8_t> code_book;
+  ASSERT_FALSE(unlimited.SerializeCodeBook(&code_book));
+
+  for (int max_length : {5, 8, 11, 12, 15, 29}) {
+    const Huffman huff(distr, tokens, max_length);
+    ASSERT_TRUE(huff.is_successful());
+    const auto codes = AllCodes(huff, tokens);
+    ASSERT_EQ(size_t(max_length), LongestCode(codes));
+    ASSERT_TRUE(AllPrefixesAreUnique(codes)) << codes;
+    const std::vector<std::string> token_codes(codes.begin() + 1, codes.end());
+    ASSERT_TRUE(CodingIsConsistent(token_codes, distr)) << token_codes << distr;
+    ASSERT_TRUE(huff.SerializeCodeBook(&code_book) == (max_length <= 15));
+    ASSERT_LE(unlimited.AverageCodeLength(distr), huff.AverageCodeLength(distr));
+  }
+
+  // With room for the unlimited code, both are optimal.
+  const Huffman huff(distr, tokens, 30);
+  ASSERT_EQ(unlimited.AverageCodeLength(distr), huff.AverageCodeLength(distr));
+}
+
+TEST(huffman_length_limited_too_short) {
+  ASSERT_FALSE(Huffman({0.5, 0.1, 0.3, 0.4}, "abcd", 2).is_successful());
+  const Huffman huff({0.5, 0.1, 0.3, 0.4}, "abcd", 3);
+  ASSERT_TRUE(huff.is_successful());
+  ASSERT_EQ(3, LongestCode(AllCodes(huff, "abcd")));
+
+  // A single code takes no bits at all.
+  ASSERT_TRUE(Huffman({}, "", 1).is_successful());
+}
+
+TEST(huffman_length_limited_cost) {
+  const std::string tokens = "abcdefghijklmnopqrstuvwxyz";
+  const auto english = EnglishLetterDistribution();
+  const auto fibonacci = FibonacciDistribution(tokens.size());
+  for (const auto* distr : {&english, &fibonacci}) {
+    const Huffman unlimited(*distr, tokens);
+    const double unlimited_bits = unlimited.AverageCodeLength(*distr);
+    LOG(INFO) << "Unlimited: " << unlimited_bits << " bits per token, longest "
+              << LongestCode(AllCodes(unlimited, tokens));
+    for (int max_length : {8, 11, 12, 15}) {
+      const Huffman huff(*distr, tokens, max_length);
+      const double bits = huff.AverageCodeLength(*distr);
+      LOG(INFO) << "At most " << max_length << " bits: " << bits << " bits per token, "
+                << 100.0 * (bits / unlimited_bits - 1.0) << "% larger";
+      ASSERT_LE(bits, unlimited_bits * 1.05);
+    }
+  }
+}
+
+TEST(huffman_copy_and_move) {
+  const std::string tokens = "abcdefghijklmnopqrstuvwxyz";
+  std::vector<std::string> codes;
+  Huffman copy({1.0}, "a");
+  {
+    const Huffman original(EnglishLetterDistribution(), tokens);
+    codes = AllCodes(original, tokens);
+    // The copy must not point into the tree of the original.
+    copy = original;
+  }
+  ASSERT_TRUE(copy.is_successful());
+  ASSERT_TRUE(AllCodes(copy, tokens) == codes);
+
+  const Huffman moved(std::move(copy));
+  ASSERT_TRUE(AllCodes(moved, tokens) == codes);
+  std::vector<uint8_t> encoded;
+  moved.EncodeFourStreams(reinterpret_cast<const uint8_t*>(tokens.data()), tokens.size(),
+                          &encoded);
+  std::string decoded(tokens.size(), ' ');
+  ASSERT_TRUE(moved.DecodeFourStreams(encoded.data(), encoded.size(), decoded.size(),
+                                      reinterpret_cast<uint8_t*>(&decoded[0])));
+  ASSERT_EQ(tokens, decoded);
+
+  // Nodes are three 16-bit indices and a flag.
+  ASSERT_EQ(8u, sizeof(Huffman::HuffmanNode));
+}
+
 }  // namespace huffman
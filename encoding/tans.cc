@@ -0,0 +1,242 @@
+#include "tans.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../bitwise/bitstream.h"
+
+using bitstream::BitInStreamer;
+using bitstream::BitOutStreamer;
+
+namespace huffman {
+namespace {
+// Floor of log2, value > 0.
+int Log2(uint32_t value) {
+  return 31 - __builtin_clz(value);
+}
+
+// Shares `slots` between the known bytes in proportion to `weights`, at
+// least one each. Rounding is corrected a slot at a time where it costs the
+// fewest bits. At least one byte must be known.
+std::array<uint32_t, 256> NormalizeWeights(std::array<double, 256> weights,
+                                           const std::array<bool, 256>& known, uint32_t slots) {
+  double total = 0.0;
+  for (size_t token = 0; token < 256; ++token) {
+    if (known[token]) total += weights[token];
+  }
+  if (total <= 0.0) {
+    // All weights zero: treat known bytes as equally likely.
+    for (size_t token = 0; token < 256; ++token) {
+      weights[token] = known[token] ? 1.0 : 0.0;
+      total += weights[token];
+    }
+  }
+
+  std::array<uint32_t, 256> frequencies{};
+  uint32_t sum = 0;
+  for (size_t token = 0; token < 256; ++token) {
+    if (!known[token]) continue;
+    frequencies[token] = std::max<uint32_t>(1, weights[token] / total * slots);
+    sum += frequencies[token];
+  }
+  while (sum != slots) {
+    const bool grow = sum < slots;
+    size_t best = 256;
+    double best_gain = 0.0;
+    for (size_t token = 0; token < 256; ++token) {
+      const uint32_t frequency = frequencies[token];
+      if (!known[token] || (!grow && frequency == 1)) continue;
+      // Bits saved by one more slot, or lost by one less, negated.
+      const double gain = grow ? weights[token] * std::log2((frequency + 1.0) / frequency)
+                               : -weights[token] * std::log2(frequency / (frequency - 1.0));
+      if (best == 256 || gain > best_gain) {
+        best = token;
+        best_gain = gain;
+      }
+    }
+    frequencies[best] += grow ? 1 : -1;
+    sum += grow ? 1 : -1;
+  }
+  return frequencies;
+}
+}  // namespace
+
+Tans::Tans(const std::vector<float>& distribution, const std::string& tokens, int table_log)
+    : Tans(distribution, std::vector<unsigned char>(tokens.begin(), tokens.end()), table_log) {}
+
+Tans::Tans(const std::vector<float>& distribution, const std::vector<unsigned char>& tokens,
+           int table_log)
+    : table_log_(table_log), tokens_(tokens) {
+  if (distribution.size() != tokens.size() || table_log < kMinTableLog ||
+      table_log > kMaxTableLog) {
+    return;
+  }
+  std::array<double, 256> weights{};
+  std::array<bool, 256> known{};
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    if (!(distribution[i] >= 0.0f)) return;
+    weights[tokens[i]] += distribution[i];
+    known[tokens[i]] = true;
+  }
+  // Escape keeps a single slot, or all of them without known tokens.
+  frequencies_[kEscapeSymbol] = 1u << table_log;
+  if (!tokens.empty()) {
+    const std::array<uint32_t, 256> frequencies =
+        NormalizeWeights(weights, known, (1u << table_log) - 1);
+    std::copy(frequencies.begin(), frequencies.end(), frequencies_.begin());
+    frequencies_[kEscapeSymbol] = 1;
+  }
+  BuildTables(frequencies_);
+  successful_ = true;
+}
+
+void Tans::BuildTables(const std::array<uint32_t, kEscapeSymbol + 1>& frequencies) {
+  const uint32_t table_size = 1u << table_log_;
+  // Scatters the slots of each symbol over the table. The step is odd, so
+  // it visits every slot once.
+  std::vector<uint16_t> symbols(table_size);
+  const uint32_t step = (table_size >> 1) + (table_size >> 3) + 3;
+  uint32_t position = 0;
+  for (size_t symbol = 0; symbol <= kEscapeSymbol; ++symbol) {
+    for (uint32_t i = 0; i < frequencies[symbol]; ++i) {
+      symbols[position] = symbol;
+      position = (position + step) & (table_size - 1);
+    }
+  }
+
+  std::array<uint32_t, kEscapeSymbol + 1> starts;
+  uint32_t start = 0;
+  for (size_t symbol = 0; symbol <= kEscapeSymbol; ++symbol) {
+    starts[symbol] = start;
+    start += frequencies[symbol];
+  }
+
+  // The i-th slot of a symbol, counting up, is reached from encoder states
+  // that drop bits down to frequency + i.
+  std::array<uint32_t, kEscapeSymbol + 1> next = frequencies;
+  state_table_.assign(table_size, 0);
+  decode_table_.assign(table_size, DecodeEntry());
+  for (uint32_t state = 0; state < table_size; ++state) {
+    const size_t symbol = symbols[state];
+    const uint32_t reduced = next[symbol]++;
+    DecodeEntry& entry = decode_table_[state];
+    entry.bits = table_log_ - Log2(reduced);
+    entry.base = (reduced << entry.bits) - table_size;
+    entry.token = symbol;
+    entry.escape = symbol == kEscapeSymbol;
+    state_table_[starts[symbol] + reduced - frequencies[symbol]] = table_size + state;
+  }
+
+  for (size_t token = 0; token < 256; ++token) {
+    const size_t symbol = frequencies[token] > 0 ? token : kEscapeSymbol;
+    const uint32_t frequency = frequencies[symbol];
+    EncodeEntry& entry = encode_table_[token];
+    entry.max_bits = table_log_ - Log2(frequency);
+    entry.threshold = frequency << entry.max_bits;
+    entry.escape = symbol == kEscapeSymbol;
+    entry.state_offset = int32_t(starts[symbol]) - int32_t(frequency);
+  }
+}
+
+uint32_t Tans::Frequency(unsigned char token) const {
+  return frequencies_[token];
+}
+
+uint32_t Tans::EscapeFrequency() const {
+  return frequencies_[kEscapeSymbol];
+}
+
+double Tans::AverageCodeLength(const std::vector<float>& distribution) const {
+  double total = 0.0;
+  double weighted = 0.0;
+  for (size_t i = 0; i < distribution.size() && i < tokens_.size(); ++i) {
+    total += distribution[i];
+    weighted += distribution[i] * (table_log_ - std::log2(frequencies_[tokens_[i]]));
+  }
+  return total > 0.0 ? weighted / total : 0.0;
+}
+
+void Tans::EncodeBlock(const uint8_t* data, size_t size, BitOutStreamer* out) const {
+  const uint32_t table_size = 1u << table_log_;
+  // Bits of each token shifted left by 5, plus their length. Collected
+  // backwards, pushed forwards.
+  std::vector<uint32_t> codes(size);
+  uint32_t states[2] = {table_size, table_size};
+  for (size_t i = size; i-- > 0;) {
+    uint32_t& state = states[i & 1];
+    const EncodeEntry& entry = encode_table_[data[i]];
+    const int bits = entry.max_bits - (state < entry.threshold);
+    uint32_t code = state & ((1u << bits) - 1);
+    int length = bits;
+    if (entry.escape) {
+      code = (code << 8) | data[i];
+      length += 8;
+    }
+    codes[i] = (code << 5) | length;
+    state = state_table_[entry.state_offset + (state >> bits)];
+  }
+
+  out->PushBits(states[0] - table_size, table_log_);
+  out->PushBits(states[1] - table_size, table_log_);
+  // Like Huffman::EncodeTokens, gathers codes in a local word first.
+  uint64_t pending = 0;
+  int num_pending = 0;
+  for (uint32_t code : codes) {
+    const int length = code & 0x1F;
+    if (num_pending + length > 64) {
+      out->PushBits(pending, num_pending);
+      pending = 0;
+      num_pending = 0;
+    }
+    pending = (pending << length) | (code >> 5);
+    num_pending += length;
+  }
+  out->PushBits(pending, num_pending);
+}
+
+void Tans::Encode(const uint8_t* data, size_t size, BitOutStreamer* out) const {
+  for (size_t offset = 0; offset < size; offset += kTansBlockTokens) {
+    EncodeBlock(data + offset, std::min(kTansBlockTokens, size - offset), out);
+  }
+}
+
+void Tans::Encode(const uint8_t* data, size_t size, std::vector<uint8_t>* out) const {
+  bitstream::VectorSink sink(out);
+  BitOutStreamer bits(&sink);
+  Encode(data, size, &bits);
+  bits.FlushRemaining();
+}
+
+bool Tans::Decode(BitInStreamer* in, size_t num_tokens, uint8_t* output) const {
+  if (!successful_) return false;
+  const DecodeEntry* table = decode_table_.data();
+  for (size_t begin = 0; begin < num_tokens; begin += kTansBlockTokens) {
+    const size_t end = std::min(num_tokens, begin + kTansBlockTokens);
+    // Even tokens use the first state, odd ones the second, so two lookups
+    // are in flight at a time.
+    uint32_t states[2];
+    states[0] = in->ReadBits(table_log_);
+    states[1] = in->ReadBits(table_log_);
+    size_t i = begin;
+    for (; i + 2 <= end; i += 2) {
+      for (size_t k = 0; k < 2; ++k) {
+        const DecodeEntry& entry = table[states[k]];
+        states[k] = entry.base + in->ReadBits(entry.bits);
+        output[i + k] = entry.escape ? in->ReadBits(8) : entry.token;
+      }
+    }
+    if (i < end) {
+      const DecodeEntry& entry = table[states[0]];
+      in->ReadBits(entry.bits);
+      output[i] = entry.escape ? in->ReadBits(8) : entry.token;
+    }
+  }
+  return !in->overrun();
+}
+
+bool Tans::Decode(const uint8_t* data, size_t size, size_t num_tokens, uint8_t* output) const {
+  BitInStreamer in(data, size);
+  return Decode(&in, num_tokens, output);
+}
+
+}  // namespace huffman
@@ -0,0 +1,122 @@
+// Table-based asymmetric numeral systems (tANS), as in FSE.
+//
+// Like Huffman coding, every token has a fixed share of a table, but a state
+// carried from token to token lets codes take fractional bits. So a token of
+// probability p costs close to -log2(p) bits, where Huffman rounds to whole
+// bits and spends up to one bit more per token on skewed distributions.
+//
+// Each token gets a number of the 2^table_log table slots proportional to its
+// weight, at least one. Unknown tokens are coded as one Escape slot followed
+// by the byte. Both encoding and decoding are one table lookup per token.
+//
+// Even and odd tokens take turns with two states, so the decoder has two
+// independent lookups in flight. The encoder runs backwards over the tokens,
+// so input is coded in blocks of kTansBlockTokens tokens, each starting with
+// the decoder's first states:
+// [even state, table_log bits][odd state][bits of each token, in order]...
+//
+// Example:
+// Tans tans(EnglishLetterDistribution(), "abcdefghijklmnopqrstuvwxyz");
+// std::vector<uint8_t> encoded;
+// tans.Encode(data, size, &encoded);
+// tans.Decode(encoded.data(), encoded.size(), size, output);
+
+#ifndef TANS_H
+#define TANS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bitstream {
+class BitInStreamer;
+class BitOutStreamer;
+}  // namespace bitstream
+
+namespace huffman {
+
+// Tokens per independently started block, bounding the encoder's buffer.
+const size_t kTansBlockTokens = 1 << 16;
+
+class Tans {
+ public:
+  // Smallest table with a slot for all 256 bytes and Escape.
+  static const int kMinTableLog = 9;
+  static const int kMaxTableLog = 15;
+  // Decoding table of 2^11 entries fits in L1.
+  static const int kDefaultTableLog = 11;
+
+  // Same arguments as Huffman. Repeated tokens add their weights.
+  // Not successful unless kMinTableLog <= table_log <= kMaxTableLog and the
+  // sizes match.
+  Tans(const std::vector<float>& distribution, const std::vector<unsigned char>& tokens,
+       int table_log = kDefaultTableLog);
+  Tans(const std::vector<float>& distribution, const std::string& tokens,
+       int table_log = kDefaultTableLog);
+
+  bool is_successful() const { return successful_; }
+  int table_log() const { return table_log_; }
+
+  // Table slots of `token` out of 2^table_log, 0 if it is unknown.
+  uint32_t Frequency(unsigned char token) const;
+  // Table slots of the Escape token, all of them if no token is known.
+  uint32_t EscapeFrequency() const;
+
+  // Expected bits per token, with distribution[i] the weight of tokens[i]
+  // as given to the constructor. Escapes are not counted.
+  double AverageCodeLength(const std::vector<float>& distribution) const;
+
+  // Pushes the codes of the `size` bytes at `data`.
+  void Encode(const uint8_t* data, size_t size, bitstream::BitOutStreamer* out) const;
+  // Appends the codes to `out`, padded to a byte.
+  void Encode(const uint8_t* data, size_t size, std::vector<uint8_t>* out) const;
+
+  // Decodes `num_tokens` tokens, the same number as were encoded.
+  // Returns false if the input ends before that.
+  bool Decode(bitstream::BitInStreamer* in, size_t num_tokens, uint8_t* output) const;
+  bool Decode(const uint8_t* data, size_t size, size_t num_tokens, uint8_t* output) const;
+
+ private:
+  // Symbol of the Escape token, after the 256 bytes.
+  static const size_t kEscapeSymbol = 256;
+
+  // How to code one byte from an encoder state in [L, 2L), L = 2^table_log.
+  struct EncodeEntry {
+    // States from this up drop max_bits low bits, below it one bit less.
+    uint32_t threshold = 0;
+    uint8_t max_bits = 0;
+    bool escape = false;
+    // Added to the state after dropping bits to index state_table_.
+    int32_t state_offset = 0;
+  };
+
+  // What one decoder state in [0, L) decodes to.
+  struct DecodeEntry {
+    uint16_t base = 0;  // Next state before adding the bits read.
+    uint8_t bits = 0;   // Bits of the next state to read.
+    uint8_t token = 0;
+    bool escape = false;  // The byte follows the state bits.
+  };
+
+  // Fills the tables from the slots of each symbol, which sum to L.
+  void BuildTables(const std::array<uint32_t, kEscapeSymbol + 1>& frequencies);
+
+  // Pushes one block of at most kTansBlockTokens tokens.
+  void EncodeBlock(const uint8_t* data, size_t size, bitstream::BitOutStreamer* out) const;
+
+  bool successful_ = false;
+  int table_log_ = 0;
+  std::vector<unsigned char> tokens_;
+  std::array<uint32_t, kEscapeSymbol + 1> frequencies_{};
+
+  std::array<EncodeEntry, 256> encode_table_;
+  // Encoder states, L plus the decoder state, grouped by symbol.
+  std::vector<uint16_t> state_table_;
+  std::vector<DecodeEntry> decode_table_;
+};
+
+}  // namespace huffman
+
+#endif
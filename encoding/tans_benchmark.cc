@@ -0,0 +1,119 @@
+#include "tans.h"
+
+#include <vector>
+
+#include "../base/benchmark.h"
+#include "../base/logging.h"
+#include "../bitwise/bitstream.h"
+#include "huffman.h"
+
+namespace huffman {
+namespace {
+const size_t kTextSize = 1 << 20;
+const char kLetters[] = "abcdefghijklmnopqrstuvwxyz";
+
+// Lower case letters drawn from the English distribution, as in
+// huffman_benchmark.cc.
+const std::vector<uint8_t>& Text() {
+  static const std::vector<uint8_t>* text = [] {
+    const std::vector<float> distribution = EnglishLetterDistribution();
+    std::vector<uint8_t>* result = new std::vector<uint8_t>();
+    uint32_t value = 12345;
+    while (result->size() < kTextSize) {
+      value = value * 1103515245 + 12345;
+      float sample = ((value >> 8) & 0xFFFF) / 65536.0f;
+      size_t letter = 0;
+      while (letter + 1 < distribution.size() && sample >= distribution[letter]) {
+        sample -= distribution[letter];
+        ++letter;
+      }
+      result->push_back(kLetters[letter]);
+    }
+    return result;
+  }();
+  return *text;
+}
+
+const Tans& EnglishTans() {
+  static const Tans* tans = new Tans(EnglishLetterDistribution(), kLetters);
+  return *tans;
+}
+
+const Huffman& English() {
+  static const Huffman* huffman = new Huffman(EnglishLetterDistribution(), kLetters);
+  return *huffman;
+}
+
+const std::vector<uint8_t>& TansEncoded() {
+  static const std::vector<uint8_t>* encoded = [] {
+    std::vector<uint8_t>* result = new std::vector<uint8_t>();
+    EnglishTans().Encode(Text().data(), Text().size(), result);
+    return result;
+  }();
+  return *encoded;
+}
+
+const std::vector<uint8_t>& HuffmanEncoded() {
+  static const std::vector<uint8_t>* encoded = [] {
+    std::vector<uint8_t>* result = new std::vector<uint8_t>();
+    bitstream::VectorSink sink(result);
+    bitstream::BitOutStreamer out(&sink);
+    English().EncodeTokens(Text().data(), Text().size(), &out);
+    out.FlushRemaining();
+    return result;
+  }();
+  return *encoded;
+}
+
+// Logs the sizes of both codes once, next to the throughput.
+void LogRatios() {
+  static const bool logged = [] {
+    LOG(INFO) << "tANS: " << TansEncoded().size() << " bytes, Huffman: "
+              << HuffmanEncoded().size() << " bytes, for " << Text().size() << " letters";
+    return true;
+  }();
+  benchmark::DoNotOptimize(logged);
+}
+
+std::vector<uint8_t> output(kTextSize);
+}  // namespace
+
+BENCHMARK(tans_build_tables) {
+  Tans tans(EnglishLetterDistribution(), kLetters);
+  benchmark::DoNotOptimize(&tans);
+  SetItemsProcessed(1, "tables");
+}
+
+BENCHMARK(tans_encode) {
+  LogRatios();
+  static std::vector<uint8_t> encoded;
+  encoded.clear();
+  EnglishTans().Encode(Text().data(), Text().size(), &encoded);
+  SetBytesProcessed(Text().size());
+}
+
+BENCHMARK(huffman_encode_same_text) {
+  static std::vector<uint8_t> encoded;
+  encoded.clear();
+  bitstream::VectorSink sink(&encoded);
+  bitstream::BitOutStreamer out(&sink);
+  English().EncodeTokens(Text().data(), Text().size(), &out);
+  out.FlushRemaining();
+  SetBytesProcessed(Text().size());
+}
+
+BENCHMARK(tans_decode) {
+  EnglishTans().Decode(TansEncoded().data(), TansEncoded().size(), output.size(),
+                       output.data());
+  benchmark::DoNotOptimize(output.data());
+  SetBytesProcessed(Text().size());
+}
+
+BENCHMARK(huffman_decode_same_text) {
+  English().Decode(HuffmanEncoded().data(), HuffmanEncoded().size(), output.size(),
+                   output.data());
+  benchmark::DoNotOptimize(output.data());
+  SetBytesProcessed(Text().size());
+}
+
+}  // namespace huffman
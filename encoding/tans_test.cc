@@ -0,0 +1,167 @@
+#include "tans.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "../base/testing.h"
+#include "../bitwise/bitstream.h"
+#include "huffman.h"
+
+namespace huffman {
+namespace {
+const std::string kLetters = "abcdefghijklmnopqrstuvwxyz";
+
+// Letters drawn from `distribution`, with a digit now and then to escape.
+std::vector<uint8_t> Sample(const std::vector<float>& distribution, size_t size) {
+  float total = 0.0f;
+  for (float weight : distribution) {
+    total += weight;
+  }
+  std::vector<uint8_t> result;
+  uint32_t value = 4321;
+  while (result.size() < size) {
+    value = value * 1103515245 + 12345;
+    float sample = ((value >> 8) & 0xFFFF) / 65536.0f * total;
+    if ((value >> 24) == 0) {
+      result.push_back('0' + value % 10);
+      continue;
+    }
+    size_t letter = 0;
+    while (letter + 1 < distribution.size() && sample >= distribution[letter]) {
+      sample -= distribution[letter];
+      ++letter;
+    }
+    result.push_back(kLetters[letter]);
+  }
+  return result;
+}
+
+// Each letter 0.7 times as likely as the one before, far from powers of 2.
+std::vector<float> GeometricDistribution() {
+  std::vector<float> distribution = {1.0f};
+  while (distribution.size() < kLetters.size()) {
+    distribution.push_back(distribution.back() * 0.7f);
+  }
+  return distribution;
+}
+
+double Entropy(const std::vector<float>& distribution) {
+  double total = 0.0;
+  for (float weight : distribution) {
+    total += weight;
+  }
+  double bits = 0.0;
+  for (float weight : distribution) {
+    if (weight > 0.0f) bits -= weight / total * std::log2(weight / total);
+  }
+  return bits;
+}
+
+bool RoundTrips(const Tans& tans, const std::vector<uint8_t>& data) {
+  std::vector<uint8_t> encoded;
+  tans.Encode(data.data(), data.size(), &encoded);
+  std::vector<uint8_t> decoded(data.size());
+  return tans.Decode(encoded.data(), encoded.size(), decoded.size(), decoded.data()) &&
+         decoded == data;
+}
+}  // namespace
+
+TEST(tans_frequencies) {
+  const Tans tans(EnglishLetterDistribution(), kLetters);
+  ASSERT_TRUE(tans.is_successful());
+  ASSERT_EQ(Tans::kDefaultTableLog, tans.table_log());
+  uint32_t total = tans.EscapeFrequency();
+  for (size_t token = 0; token < 256; ++token) {
+    total += tans.Frequency(token);
+  }
+  ASSERT_EQ(1u << Tans::kDefaultTableLog, total);
+  ASSERT_EQ(0u, tans.Frequency(' '));
+  ASSERT_LT(0u, tans.Frequency('z'));
+  ASSERT_LT(tans.Frequency('z'), tans.Frequency('t'));
+  ASSERT_LT(tans.Frequency('t'), tans.Frequency('e'));
+}
+
+TEST(tans_invalid) {
+  ASSERT_FALSE(Tans({0.5f, 0.5f}, "a").is_successful());
+  ASSERT_FALSE(Tans({1.0f}, "a", Tans::kMinTableLog - 1).is_successful());
+  ASSERT_FALSE(Tans({1.0f}, "a", Tans::kMaxTableLog + 1).is_successful());
+  ASSERT_FALSE(Tans({-1.0f}, "a").is_successful());
+}
+
+TEST(tans_round_trip) {
+  const std::vector<uint8_t> data = Sample(EnglishLetterDistribution(), 200000);
+  for (int table_log = Tans::kMinTableLog; table_log <= Tans::kMaxTableLog; ++table_log) {
+    const Tans tans(EnglishLetterDistribution(), kLetters, table_log);
+    ASSERT_TRUE(tans.is_successful());
+    ASSERT_TRUE(RoundTrips(tans, data));
+  }
+  const Tans tans(EnglishLetterDistribution(), kLetters);
+  ASSERT_TRUE(RoundTrips(tans, {}));
+  ASSERT_TRUE(RoundTrips(tans, {'q'}));
+  ASSERT_TRUE(RoundTrips(tans, std::vector<uint8_t>(kTansBlockTokens, 'e')));
+}
+
+TEST(tans_unknown_tokens) {
+  std::vector<uint8_t> all_bytes;
+  for (size_t i = 0; i < 3000; ++i) {
+    all_bytes.push_back(i * 13);
+  }
+  ASSERT_TRUE(RoundTrips(Tans({1.0f}, "a"), all_bytes));
+  ASSERT_TRUE(RoundTrips(Tans({}, ""), all_bytes));
+  // Repeated and zero weight tokens.
+  ASSERT_TRUE(RoundTrips(Tans({0.0f, 2.0f, 0.0f}, "aba"), all_bytes));
+}
+
+TEST(tans_streams) {
+  const std::vector<uint8_t> first = Sample(EnglishLetterDistribution(), 100000);
+  const std::vector<uint8_t> second = Sample(GeometricDistribution(), 1000);
+  const Tans english(EnglishLetterDistribution(), kLetters);
+  const Tans geometric(GeometricDistribution(), kLetters, 13);
+
+  std::vector<uint8_t> encoded;
+  {
+    bitstream::VectorSink sink(&encoded);
+    bitstream::BitOutStreamer out(&sink);
+    english.Encode(first.data(), first.size(), &out);
+    geometric.Encode(second.data(), second.size(), &out);
+  }
+  bitstream::BitInStreamer in(encoded.data(), encoded.size());
+  std::vector<uint8_t> decoded(first.size());
+  ASSERT_TRUE(english.Decode(&in, decoded.size(), decoded.data()));
+  ASSERT_TRUE(decoded == first);
+  decoded.resize(second.size());
+  ASSERT_TRUE(geometric.Decode(&in, decoded.size(), decoded.data()));
+  ASSERT_TRUE(decoded == second);
+
+  ASSERT_FALSE(english.Decode(encoded.data(), encoded.size() / 2, first.size(), decoded.data()));
+}
+
+TEST(tans_beats_huffman) {
+  const auto english = EnglishLetterDistribution();
+  const auto geometric = GeometricDistribution();
+  for (const auto* distr : {&english, &geometric}) {
+    const Tans tans(*distr, kLetters, 12);
+    const Huffman huff(*distr, kLetters);
+    const double entropy = Entropy(*distr);
+    const double tans_bits = tans.AverageCodeLength(*distr);
+    const double huffman_bits = huff.AverageCodeLength(*distr);
+    LOG(INFO) << "Entropy " << entropy << ", tANS " << tans_bits << ", Huffman " << huffman_bits
+              << " bits per token";
+    ASSERT_LE(tans_bits, huffman_bits);
+    ASSERT_LE(tans_bits, entropy * 1.01);
+
+    const std::vector<uint8_t> data = Sample(*distr, 100000);
+    std::vector<uint8_t> encoded;
+    tans.Encode(data.data(), data.size(), &encoded);
+    std::vector<uint8_t> huffman_encoded;
+    {
+      bitstream::VectorSink sink(&huffman_encoded);
+      bitstream::BitOutStreamer out(&sink);
+      huff.EncodeTokens(data.data(), data.size(), &out);
+    }
+    ASSERT_LT(encoded.size(), huffman_encoded.size());
+  }
+}
+
+}  // namespace huffman
@@ -0,0 +1,243 @@
+#include "universal_codes.h"
+
+#include <cstring>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+using bitstream::BitInStreamer;
+using bitstream::BitOutStreamer;
+
+namespace codes {
+namespace {
+const int kWindowBits = BitInStreamer::kMaxBits;
+// 32 bits need at most 5 varint bytes.
+const int kMaxVarint32Bytes = 5;
+
+// floor(log2(value)) for value >= 1.
+int Log2(uint32_t value) {
+  return 31 - __builtin_clz(value);
+}
+
+// Leading zeros of the lowest `kWindowBits` bits of a peeked window, which must not be zero.
+int LeadingZeros(uint64_t window) {
+  return __builtin_clzll(window) - (64 - kWindowBits);
+}
+
+uint64_t LowMask(int nbits) {
+  return (uint64_t(1) << nbits) - 1;
+}
+}  // namespace
+
+void PushGamma(uint32_t value, BitOutStreamer* out) {
+  // The leading zeros are the unused high bits of value.
+  const int n = Log2(value);
+  out->PushBits(value, 2 * n + 1);
+}
+
+uint32_t ReadGamma(BitInStreamer* in) {
+  const uint64_t peek = in->PeekBits(32);
+  if (peek == 0) return 0;
+  const int zeros = __builtin_clzll(peek) - 32;
+  if (2 * zeros + 1 <= kWindowBits) return in->ReadBits(2 * zeros + 1);
+  in->ConsumeBits(zeros);
+  return in->ReadBits(zeros + 1);
+}
+
+size_t ReadGammaBatch(BitInStreamer* in, uint32_t* out, size_t count) {
+  size_t i = 0;
+  while (i < count) {
+    // Decodes all codes that fit completely in one window.
+    const uint64_t window = in->PeekBits(kWindowBits);
+    int used = 0;
+    while (i < count && used < kWindowBits) {
+      const uint64_t rest = (window << used) & LowMask(kWindowBits);
+      if (rest == 0) break;
+      const int length = 2 * LeadingZeros(rest) + 1;
+      if (used + length > kWindowBits) break;
+      out[i] = rest >> (kWindowBits - length);
+      ++i;
+      used += length;
+    }
+    if (used > 0) {
+      in->ConsumeBits(used);
+      continue;
+    }
+    // Long code, or the end of input.
+    const uint32_t value = ReadGamma(in);
+    if (value == 0 || in->overrun()) break;
+    out[i] = value;
+    ++i;
+  }
+  return i;
+}
+
+void PushDelta(uint32_t value, BitOutStreamer* out) {
+  const int n = Log2(value);
+  PushGamma(n + 1, out);
+  out->PushBits(value & LowMask(n), n);
+}
+
+uint32_t ReadDelta(BitInStreamer* in) {
+  const uint32_t length = ReadGamma(in);
+  if (length == 0 || length > 32) return 0;
+  const int n = length - 1;
+  return (uint64_t(1) << n) | in->ReadBits(n);
+}
+
+size_t ReadDeltaBatch(BitInStreamer* in, uint32_t* out, size_t count) {
+  size_t i = 0;
+  for (; i < count; ++i) {
+    const uint32_t value = ReadDelta(in);
+    if (value == 0 || in->overrun()) break;
+    out[i] = value;
+  }
+  return i;
+}
+
+void PushRice(uint32_t value, int k, BitOutStreamer* out) {
+  uint32_t quotient = value >> k;
+  while (quotient > BitOutStreamer::kMaxFastBits) {
+    out->PushBits(0, BitOutStreamer::kMaxFastBits);
+    quotient -= BitOutStreamer::kMaxFastBits;
+  }
+  out->PushBits(0, quotient);
+  out->PushBits((uint64_t(1) << k) | (value & LowMask(k)), k + 1);
+}
+
+uint32_t ReadRice(int k, BitInStreamer* in) {
+  uint32_t quotient = 0;
+  while (true) {
+    const uint64_t peek = in->PeekBits(kWindowBits);
+    if (peek != 0) {
+      const int zeros = LeadingZeros(peek);
+      quotient += zeros;
+      in->ConsumeBits(zeros + 1);
+      break;
+    }
+    in->ConsumeBits(kWindowBits);
+    if (in->overrun()) return 0;
+    quotient += kWindowBits;
+  }
+  return (quotient << k) | in->ReadBits(k);
+}
+
+size_t ReadRiceBatch(int k, BitInStreamer* in, uint32_t* out, size_t count) {
+  size_t i = 0;
+  while (i < count) {
+    // Decodes all codes that fit completely in one window.
+    const uint64_t window = in->PeekBits(kWindowBits);
+    int used = 0;
+    while (i < count && used < kWindowBits) {
+      const uint64_t rest = (window << used) & LowMask(kWindowBits);
+      if (rest == 0) break;
+      const int zeros = LeadingZeros(rest);
+      const int length = zeros + 1 + k;
+      if (used + length > kWindowBits) break;
+      const uint32_t remainder = (rest >> (kWindowBits - length)) & LowMask(k);
+      out[i] = (uint32_t(zeros) << k) | remainder;
+      ++i;
+      used += length;
+    }
+    if (used > 0) {
+      in->ConsumeBits(used);
+      continue;
+    }
+    // Long code, or the end of input.
+    const uint32_t value = ReadRice(k, in);
+    if (in->overrun()) break;
+    out[i] = value;
+    ++i;
+  }
+  return i;
+}
+
+size_t EncodeVarint(uint64_t value, uint8_t* out) {
+  size_t size = 0;
+  while (value >= 0x80) {
+    out[size] = value | 0x80;
+    ++size;
+    value >>= 7;
+  }
+  out[size] = value;
+  return size + 1;
+}
+
+const uint8_t* DecodeVarint(const uint8_t* data, const uint8_t* end, uint64_t* value) {
+  uint64_t result = 0;
+  for (size_t i = 0; i < kMaxVarintBytes && data != end; ++i, ++data) {
+    const uint64_t byte = *data;
+    // The last byte may only hold the 64th bit.
+    if (i == kMaxVarintBytes - 1 && byte > 1) return nullptr;
+    result |= (byte & 0x7F) << (7 * i);
+    if (byte < 0x80) {
+      *value = result;
+      return data + 1;
+    }
+  }
+  return nullptr;
+}
+
+void PushVarint(uint64_t value, BitOutStreamer* out) {
+  uint8_t bytes[kMaxVarintBytes];
+  out->PushBytesAligned(bytes, EncodeVarint(value, bytes));
+}
+
+bool ReadVarint(BitInStreamer* in, uint64_t* value) {
+  uint64_t result = 0;
+  for (size_t i = 0; i < kMaxVarintBytes; ++i) {
+    const uint64_t byte = in->ReadBits(8);
+    if (in->overrun()) return false;
+    if (i == kMaxVarintBytes - 1 && byte > 1) return false;
+    result |= (byte & 0x7F) << (7 * i);
+    if (byte < 0x80) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t DecodeVarintBatch(const uint8_t* data, size_t size, uint32_t* out, size_t count,
+                         size_t* consumed) {
+  const uint8_t* next = data;
+  const uint8_t* const end = data + size;
+  size_t i = 0;
+  while (i < count) {
+    // Single byte values are the common case for gaps.
+    if (next != end && *next < 0x80) {
+      out[i] = *next;
+      ++i;
+      ++next;
+      continue;
+    }
+#if defined(__BMI2__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (end - next >= 8) {
+      uint64_t word;
+      memcpy(&word, next, sizeof(word));
+      // The first byte without continuation bit ends the varint.
+      const uint64_t stops = ~word & 0x8080808080808080ull;
+      const int length = stops == 0 ? 9 : __builtin_ctzll(stops) / 8 + 1;
+      if (length > kMaxVarint32Bytes) break;
+      const uint64_t value = _pext_u64(word, 0x7F7F7F7F7Full & LowMask(8 * length));
+      if (value > UINT32_MAX) break;
+      out[i] = value;
+      ++i;
+      next += length;
+      continue;
+    }
+#endif
+    uint64_t value = 0;
+    const uint8_t* after = DecodeVarint(next, end, &value);
+    // Overlong varints are rejected on both paths, even with a value that fits.
+    if (after == nullptr || after - next > kMaxVarint32Bytes || value > UINT32_MAX) break;
+    out[i] = value;
+    ++i;
+    next = after;
+  }
+  *consumed = next - data;
+  return i;
+}
+
+}  // namespace codes
@@ -0,0 +1,72 @@
+// Universal integer codes on top of the bitstream layer.
+//
+// Bit codes are written to a BitOutStreamer and read back from a
+// BitInStreamer, so they can be mixed freely with Huffman codes in the same
+// stream. The unary parts are runs of zeros ended by a one, which lets the
+// decoders count them with a single clz instead of a loop.
+//
+// Example:
+// PushGamma(5, &out);  // 00101
+// PushDelta(10, &out);  // 00100 010
+// PushRice(9, 2, &out);  // 001 01
+// PushVarint(300, &out);  // 1010 1100 0000 0010
+
+#ifndef UNIVERSAL_CODES_H
+#define UNIVERSAL_CODES_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../bitwise/bitstream.h"
+
+namespace codes {
+
+// Elias gamma: floor(log2(value)) zeros followed by value in binary.
+// value must be at least 1. Codes are at most 63 bits long.
+void PushGamma(uint32_t value, bitstream::BitOutStreamer* out);
+// Returns 0 for an invalid code, ie. 32 or more leading zeros.
+uint32_t ReadGamma(bitstream::BitInStreamer* in);
+
+// Elias delta: the bit length of value as gamma code, followed by value
+// without its leading one. value must be at least 1.
+void PushDelta(uint32_t value, bitstream::BitOutStreamer* out);
+// Returns 0 for an invalid code.
+uint32_t ReadDelta(bitstream::BitInStreamer* in);
+
+// Golomb-Rice with divisor 2^k: value >> k in unary, followed by the lowest k bits.
+// 0 <= k <= 31. Works for all values but is only compact for value < 2^k * small.
+void PushRice(uint32_t value, int k, bitstream::BitOutStreamer* out);
+uint32_t ReadRice(int k, bitstream::BitInStreamer* in);
+
+// Batch decoders. Decode up to `count` values into `out` and return how many
+// were decoded, less than `count` if the input ended or held an invalid code.
+// Running past the end of a Rice coded input sets in->overrun().
+size_t ReadGammaBatch(bitstream::BitInStreamer* in, uint32_t* out, size_t count);
+size_t ReadDeltaBatch(bitstream::BitInStreamer* in, uint32_t* out, size_t count);
+size_t ReadRiceBatch(int k, bitstream::BitInStreamer* in, uint32_t* out, size_t count);
+
+// LEB128 varint: 7 bits per byte starting with the lowest, the high bit of
+// each byte is set iff more bytes follow. At most kMaxVarintBytes bytes.
+const size_t kMaxVarintBytes = 10;
+
+// Writes the varint as whole bytes to the bitstream, byte aligned or not.
+void PushVarint(uint64_t value, bitstream::BitOutStreamer* out);
+// Returns false on a truncated or overlong varint.
+bool ReadVarint(bitstream::BitInStreamer* in, uint64_t* value);
+
+// Writes to `out`, which must have room for kMaxVarintBytes.
+// Returns the number of bytes written.
+size_t EncodeVarint(uint64_t value, uint8_t* out);
+// Returns a pointer past the varint, or nullptr on a truncated or overlong varint.
+const uint8_t* DecodeVarint(const uint8_t* data, const uint8_t* end, uint64_t* value);
+
+// Decodes up to `count` varints that fit in 32 bits from [data, data + size),
+// stopping at one longer than 5 bytes. Returns the number of values decoded
+// and sets `*consumed` to the number of bytes they used. Uses pext where
+// available.
+size_t DecodeVarintBatch(const uint8_t* data, size_t size, uint32_t* out, size_t count,
+                         size_t* consumed);
+
+}  // namespace codes
+
+#endif
@@ -0,0 +1,110 @@
+
+#include "universal_codes.h"
+
+#include <vector>
+
+#include "../base/benchmark.h"
+
+using bitstream::BitInStreamer;
+using bitstream::BitOutStreamer;
+
+namespace codes {
+namespace {
+const size_t kNumValues = 1 << 16;
+
+// Small gaps, like the deltas of a sorted posting list.
+const std::vector<uint32_t>& Gaps() {
+  static const std::vector<uint32_t>* gaps = [] {
+    std::vector<uint32_t>* result = new std::vector<uint32_t>();
+    uint32_t value = 12345;
+    for (size_t i = 0; i < kNumValues; ++i) {
+      value = value * 1103515245 + 12345;
+      result->push_back(1 + ((value >> 16) & 0x3F));
+    }
+    return result;
+  }();
+  return *gaps;
+}
+
+template <typename PushFunction>
+std::vector<uint8_t> Encode(PushFunction push) {
+  std::vector<uint8_t> bytes;
+  bitstream::VectorSink sink(&bytes);
+  BitOutStreamer bit_stream(&sink);
+  for (uint32_t value : Gaps()) {
+    push(value, &bit_stream);
+  }
+  bit_stream.FlushRemaining();
+  return bytes;
+}
+
+const std::vector<uint8_t>& GammaEncoded() {
+  static const std::vector<uint8_t> bytes = Encode(PushGamma);
+  return bytes;
+}
+
+const std::vector<uint8_t>& RiceEncoded() {
+  static const std::vector<uint8_t> bytes =
+      Encode([](uint32_t value, BitOutStreamer* out) { PushRice(value, 4, out); });
+  return bytes;
+}
+
+const std::vector<uint8_t>& VarintEncoded() {
+  static const std::vector<uint8_t> bytes = Encode(PushVarint);
+  return bytes;
+}
+
+std::vector<uint32_t> decoded(kNumValues);
+}  // namespace
+
+BENCHMARK(gamma_push) {
+  benchmark::DoNotOptimize(Encode(PushGamma).size());
+  SetItemsProcessed(kNumValues, "values");
+}
+
+BENCHMARK(gamma_read_single) {
+  BitInStreamer in(GammaEncoded().data(), GammaEncoded().size());
+  for (size_t i = 0; i < kNumValues; ++i) {
+    decoded[i] = ReadGamma(&in);
+  }
+  SetItemsProcessed(kNumValues, "values");
+}
+
+BENCHMARK(gamma_read_batch) {
+  BitInStreamer in(GammaEncoded().data(), GammaEncoded().size());
+  benchmark::DoNotOptimize(ReadGammaBatch(&in, decoded.data(), kNumValues));
+  SetItemsProcessed(kNumValues, "values");
+}
+
+BENCHMARK(rice_read_single) {
+  BitInStreamer in(RiceEncoded().data(), RiceEncoded().size());
+  for (size_t i = 0; i < kNumValues; ++i) {
+    decoded[i] = ReadRice(4, &in);
+  }
+  SetItemsProcessed(kNumValues, "values");
+}
+
+BENCHMARK(rice_read_batch) {
+  BitInStreamer in(RiceEncoded().data(), RiceEncoded().size());
+  benchmark::DoNotOptimize(ReadRiceBatch(4, &in, decoded.data(), kNumValues));
+  SetItemsProcessed(kNumValues, "values");
+}
+
+BENCHMARK(varint_read_single) {
+  BitInStreamer in(VarintEncoded().data(), VarintEncoded().size());
+  for (size_t i = 0; i < kNumValues; ++i) {
+    uint64_t value = 0;
+    ReadVarint(&in, &value);
+    decoded[i] = value;
+  }
+  SetItemsProcessed(kNumValues, "values");
+}
+
+BENCHMARK(varint_decode_batch) {
+  size_t consumed = 0;
+  benchmark::DoNotOptimize(DecodeVarintBatch(VarintEncoded().data(), VarintEncoded().size(),
+                                             decoded.data(), kNumValues, &consumed));
+  SetItemsProcessed(kNumValues, "values");
+}
+
+}  // namespace codes
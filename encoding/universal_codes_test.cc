@@ -0,0 +1,189 @@
+#include "universal_codes.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../base/testing.h"
+
+using bitstream::BitInStreamer;
+using bitstream::BitOutStreamer;
+
+namespace codes {
+namespace {
+// Returns string of '1' and '0' for the written bits, without padding.
+template <typename PushFunction>
+std::string Bits(PushFunction push) {
+  std::ostringstream output;
+  BitOutStreamer bit_stream(&output);
+  push(&bit_stream);
+  // Marks the end so padding can be removed.
+  bit_stream.PushBit(true);
+  bit_stream.FlushRemaining();
+  std::string bits;
+  for (unsigned char c : output.str()) {
+    for (int i = 7; i >= 0; --i) {
+      bits.push_back(((c >> i) & 1) ? '1' : '0');
+    }
+  }
+  return bits.substr(0, bits.rfind('1'));
+}
+
+std::vector<uint32_t> TestValues() {
+  std::vector<uint32_t> values = {1, 2, 3, 4, 5, 7, 8, 100, 1000, 65535, 65536,
+                                  (1u << 27) + 5, (1u << 28) - 1, 1u << 31, UINT32_MAX};
+  uint32_t value = 12345;
+  for (int i = 0; i < 1000; ++i) {
+    value = value * 1103515245 + 12345;
+    // Mostly small values, like deltas of sorted ids.
+    values.push_back(1 + (value >> (8 + i % 24)));
+  }
+  return values;
+}
+
+std::vector<uint8_t> Bytes(const std::string& str) {
+  return std::vector<uint8_t>(str.begin(), str.end());
+}
+}  // namespace
+
+TEST(gamma_codes) {
+  ASSERT_EQ("1", Bits([](BitOutStreamer* out) { PushGamma(1, out); }));
+  ASSERT_EQ("010", Bits([](BitOutStreamer* out) { PushGamma(2, out); }));
+  ASSERT_EQ("00101", Bits([](BitOutStreamer* out) { PushGamma(5, out); }));
+  ASSERT_EQ(63, Bits([](BitOutStreamer* out) { PushGamma(UINT32_MAX, out); }).size());
+}
+
+TEST(delta_codes) {
+  ASSERT_EQ("1", Bits([](BitOutStreamer* out) { PushDelta(1, out); }));
+  ASSERT_EQ("0100", Bits([](BitOutStreamer* out) { PushDelta(2, out); }));
+  ASSERT_EQ("00100010", Bits([](BitOutStreamer* out) { PushDelta(10, out); }));
+}
+
+TEST(rice_codes) {
+  ASSERT_EQ("100", Bits([](BitOutStreamer* out) { PushRice(0, 2, out); }));
+  ASSERT_EQ("00101", Bits([](BitOutStreamer* out) { PushRice(9, 2, out); }));
+  ASSERT_EQ("0001", Bits([](BitOutStreamer* out) { PushRice(3, 0, out); }));
+  ASSERT_EQ(std::string(100, '0') + "1", Bits([](BitOutStreamer* out) { PushRice(100, 0, out); }));
+}
+
+TEST(universal_round_trip) {
+  const std::vector<uint32_t> values = TestValues();
+  std::ostringstream output;
+  {
+    BitOutStreamer bit_stream(&output);
+    for (uint32_t value : values) {
+      PushGamma(value, &bit_stream);
+      PushDelta(value, &bit_stream);
+      PushRice(value, 20, &bit_stream);
+      PushVarint(value, &bit_stream);
+    }
+  }
+  std::istringstream input(output.str());
+  BitInStreamer in(&input);
+  for (uint32_t value : values) {
+    ASSERT_EQ(value, ReadGamma(&in));
+    ASSERT_EQ(value, ReadDelta(&in));
+    ASSERT_EQ(value, ReadRice(20, &in));
+    uint64_t varint = 0;
+    ASSERT_TRUE(ReadVarint(&in, &varint));
+    ASSERT_EQ(value, varint);
+  }
+  ASSERT_TRUE(in.AtPadding());
+  ASSERT_FALSE(in.overrun());
+}
+
+TEST(batch_round_trip) {
+  const std::vector<uint32_t> values = TestValues();
+  for (int codec = 0; codec < 3; ++codec) {
+    std::vector<uint8_t> bytes;
+    {
+      bitstream::VectorSink sink(&bytes);
+      BitOutStreamer bit_stream(&sink);
+      for (uint32_t value : values) {
+        if (codec == 0) PushGamma(value, &bit_stream);
+        if (codec == 1) PushDelta(value, &bit_stream);
+        if (codec == 2) PushRice(value, 12, &bit_stream);
+      }
+    }
+    BitInStreamer in(bytes.data(), bytes.size());
+    std::vector<uint32_t> decoded(values.size());
+    size_t num_decoded = 0;
+    if (codec == 0) num_decoded = ReadGammaBatch(&in, decoded.data(), decoded.size());
+    if (codec == 1) num_decoded = ReadDeltaBatch(&in, decoded.data(), decoded.size());
+    if (codec == 2) num_decoded = ReadRiceBatch(12, &in, decoded.data(), decoded.size());
+    ASSERT_EQ(values.size(), num_decoded) << "codec " << codec;
+    ASSERT_TRUE(values == decoded) << "codec " << codec;
+    ASSERT_TRUE(in.AtPadding());
+    ASSERT_FALSE(in.overrun());
+  }
+}
+
+TEST(gamma_batch_stops_at_end) {
+  std::vector<uint8_t> bytes;
+  {
+    bitstream::VectorSink sink(&bytes);
+    BitOutStreamer bit_stream(&sink);
+    for (uint32_t value = 1; value <= 10; ++value) {
+      PushGamma(value, &bit_stream);
+    }
+  }
+  BitInStreamer in(bytes.data(), bytes.size());
+  uint32_t decoded[20];
+  ASSERT_EQ(10, ReadGammaBatch(&in, decoded, 20));
+  ASSERT_EQ(10, decoded[9]);
+}
+
+TEST(varint_bytes) {
+  uint8_t bytes[kMaxVarintBytes];
+  ASSERT_EQ(1, EncodeVarint(0, bytes));
+  ASSERT_EQ(0, bytes[0]);
+  ASSERT_EQ(2, EncodeVarint(300, bytes));
+  ASSERT_EQ(0xAC, bytes[0]);
+  ASSERT_EQ(0x02, bytes[1]);
+  ASSERT_EQ(kMaxVarintBytes, EncodeVarint(UINT64_MAX, bytes));
+
+  uint64_t value = 0;
+  ASSERT_TRUE(DecodeVarint(bytes, bytes + kMaxVarintBytes, &value) == bytes + kMaxVarintBytes);
+  ASSERT_EQ(UINT64_MAX, value);
+  // Truncated.
+  ASSERT_TRUE(DecodeVarint(bytes, bytes + 3, &value) == nullptr);
+  // Overlong.
+  bytes[9] = 0x02;
+  ASSERT_TRUE(DecodeVarint(bytes, bytes + kMaxVarintBytes, &value) == nullptr);
+}
+
+TEST(varint_batch) {
+  const std::vector<uint32_t> values = TestValues();
+  std::vector<uint8_t> bytes;
+  for (uint32_t value : values) {
+    uint8_t encoded[kMaxVarintBytes];
+    const size_t size = EncodeVarint(value, encoded);
+    bytes.insert(bytes.end(), encoded, encoded + size);
+  }
+  std::vector<uint32_t> decoded(values.size() + 1);
+  size_t consumed = 0;
+  ASSERT_EQ(values.size(), DecodeVarintBatch(bytes.data(), bytes.size(), decoded.data(),
+                                             decoded.size(), &consumed));
+  ASSERT_EQ(bytes.size(), consumed);
+  decoded.pop_back();
+  ASSERT_TRUE(values == decoded);
+
+  // Stops at values that do not fit 32 bits.
+  const std::vector<uint8_t> large = Bytes("\x05\x80\x80\x80\x80\x10\x07");
+  ASSERT_EQ(1, DecodeVarintBatch(large.data(), large.size(), decoded.data(), 3, &consumed));
+  ASSERT_EQ(1, consumed);
+
+  // Stops at overlong values, with or without pext, though DecodeVarint takes them.
+  const std::vector<uint8_t> overlong = Bytes(std::string("\x05\x80\x80\x80\x80\x80\x00\x07", 8));
+  const uint8_t* const end = overlong.data() + overlong.size();
+  uint64_t value = 1;
+  ASSERT_TRUE(DecodeVarint(overlong.data() + 1, end, &value) == end - 1);
+  ASSERT_EQ(0u, value);
+  ASSERT_EQ(1, DecodeVarintBatch(overlong.data(), overlong.size(), decoded.data(), 3, &consumed));
+  ASSERT_EQ(1, consumed);
+  // Also when fewer than 8 bytes are left.
+  ASSERT_EQ(0, DecodeVarintBatch(overlong.data() + 1, 6, decoded.data(), 3, &consumed));
+  ASSERT_EQ(0, consumed);
+}
+
+}  // namespace codes